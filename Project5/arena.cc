@@ -0,0 +1,52 @@
+/* File: arena.cc
+ * --------------
+ * Implementation of the Arena class.
+ */
+
+#include "arena.h"
+#include "utility.h"
+
+
+/* Method: AllocateSlow
+ * --------------------
+ * Starts a new chunk when the current one cannot fit the request. A
+ * request bigger than a quarter chunk gets a chunk of its own, kept
+ * behind the current one, so it doesn't waste what is left of it.
+ */
+void *Arena::AllocateSlow(size_t size)
+{
+    if (size > ChunkSize / 4) {
+        char *block = (char*)malloc(size);
+        if (!block) Failure("Out of memory!");
+        chunks.insert(chunks.end() - (chunks.empty() ? 0 : 1), block);
+        return block;
+    }
+    next = (char*)malloc(ChunkSize);
+    if (!next) Failure("Out of memory!");
+    chunks.push_back(next);
+    end = next + ChunkSize;
+    void *p = next;
+    next += size;
+    return p;
+}
+
+void Arena::Release()
+{
+    for (int i = 0; i < (int)chunks.size(); i++)
+        free(chunks[i]);
+    chunks.clear();
+    next = end = NULL;
+}
+
+
+Arena *AstArena()
+{
+    static Arena arena;
+    return &arena;
+}
+
+Arena *TacArena()
+{
+    static thread_local Arena arena;
+    return &arena;
+}
@@ -0,0 +1,105 @@
+/* File: arena.h
+ * -------------
+ * An Arena hands out memory by bumping a pointer through large chunks
+ * and gives it all back at once. The front end builds the AST in one
+ * (see AstArena()): the nodes, their locations and the lists of their
+ * children are laid out one after another in the order the parser
+ * makes them, and none of them outlives the compilation, so instead of
+ * being freed one by one (or, as before, not at all) they go together
+ * when the arena is released. The TAC instructions and their operands
+ * likewise go in TacArena().
+ *
+ * Nothing in an arena has its destructor run. An arena is not thread
+ * safe, which is fine for the AST since only the front end builds it.
+ */
+
+#ifndef _H_arena
+#define _H_arena
+
+#include <stddef.h>
+#include <vector>
+
+
+class Arena {
+  private:
+    static const size_t ChunkSize = 64 * 1024;
+    static const size_t Alignment = 8;   // enough for pointers and doubles
+
+    std::vector<char*> chunks;
+    char *next, *end;                     // free part of the newest chunk
+
+    void *AllocateSlow(size_t size);
+
+  public:
+    Arena() : next(NULL), end(NULL) {}
+    ~Arena() { Release(); }
+
+          // Returns size bytes of uninitialized memory, suitably
+          // aligned for anything the AST stores
+    void *Allocate(size_t size)
+        { size = (size + Alignment - 1) & ~(Alignment - 1);
+          if ((size_t)(end - next) < size) return AllocateSlow(size);
+          void *p = next; next += size; return p; }
+
+          // Frees everything allocated so far; the arena can be
+          // reused afterwards
+    void Release();
+};
+
+
+/* Function: AstArena()
+ * Usage: node = new (AstArena()) yyltype(loc);
+ * --------------------------------------------
+ * Returns the arena the AST of the current compilation is built in.
+ * It exists from the first call (which may come from a static
+ * initializer, e.g. for the built-in types) until main releases it.
+ */
+Arena *AstArena();
+
+
+/* Function: TacArena()
+ * Usage: return TacArena()->Allocate(size);
+ * -----------------------------------------
+ * Returns the arena TAC instructions and Locations are allocated in.
+ * Each thread has its own, so that the -j back end's workers can make
+ * TAC for the function they are on; a worker's arena goes when the
+ * worker finishes, and the main thread's when main releases it.
+ */
+Arena *TacArena();
+
+
+/* Placement new for arenas, e.g.  new (AstArena()) yyltype(loc)
+ * The memory is reclaimed with the arena, so there is no matching
+ * delete to call.
+ */
+inline void *operator new(size_t size, Arena *arena)
+{
+    return arena->Allocate(size);
+}
+inline void operator delete(void *, Arena *) {}  // only if a ctor throws
+
+
+/* Class: ArenaAllocator
+ * ---------------------
+ * An STL allocator drawing from an arena, or from the heap when it has
+ * none, so one container type can be used for both. Deallocating arena
+ * memory does nothing.
+ */
+template <class T> class ArenaAllocator {
+  public:
+    typedef T value_type;
+    Arena *arena;
+
+    ArenaAllocator(Arena *a = NULL) : arena(a) {}
+    template <class U> ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t n)
+        { return (T*)(arena ? arena->Allocate(n * sizeof(T)) : ::operator new(n * sizeof(T))); }
+    void deallocate(T *p, size_t n)
+        { if (!arena) ::operator delete(p); }
+
+    template <class U> bool operator==(const ArenaAllocator<U> &other) const { return arena == other.arena; }
+    template <class U> bool operator!=(const ArenaAllocator<U> &other) const { return arena != other.arena; }
+};
+
+#endif
@@ -9,9 +9,10 @@
 #include <stdio.h>  // printf
 #include "errors.h"
 #include "scope.h"
+#include "intern.h"
 
 Node::Node(yyltype loc) {
-    location = new yyltype(loc);
+    location = new (AstArena()) yyltype(loc);
     parent = NULL;
     nodeScope = NULL;
 }
@@ -33,7 +34,7 @@ Decl *Node::FindDecl(Identifier *idToFind, lookup l) {
 }
 	 
 Identifier::Identifier(yyltype loc, const char *n) : Node(loc) {
-    name = strdup(n);
+    name = n;
     cached = NULL;
 } 
 
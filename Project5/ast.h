@@ -18,6 +18,10 @@
  * instead we wait until assigning the children into the parent node and then 
  * set up links in both directions. The parent link is typically not used 
  * during parsing, but is more important in later phases.
+ *
+ * Memory: Nodes and their locations are allocated in the AST arena (see
+ * arena.h) and are never deleted on their own; they all go at once when
+ * the compilation is over.
 
  */
 
@@ -26,6 +30,7 @@
 
 #include <stdlib.h>   // for NULL
 #include "location.h"
+#include "arena.h"
 #include <iostream>
 class Scope;
 class Decl;
@@ -43,6 +48,9 @@ class Node
   public:
     Node(yyltype loc);
     Node();
+
+    static void *operator new(size_t size) { return AstArena()->Allocate(size); }
+    static void operator delete(void *p) {}
     
     yyltype *GetLocation()   { return location; }
     void SetParent(Node *p)  { parent = p; }
@@ -68,11 +76,11 @@ class Node
 class Identifier : public Node 
 {
   protected:
-    char *name;
+    const char *name;      // interned, so names compare by pointer
     Decl *cached;
     
   public:
-    Identifier(yyltype loc, const char *name);
+    Identifier(yyltype loc, const char *name); // name from Intern()
     friend std::ostream& operator<<(std::ostream& out, Identifier *id) { return out << id->name; }
     const char *GetName() { return name; }
     Decl *GetDeclRelativeToBase(Type *base = NULL);
@@ -9,6 +9,7 @@
 #include "errors.h"
 #include "scanner.h" // for MaxIdentLen
 #include "codegen.h"
+#include "intern.h"
         
          
 Decl::Decl(Identifier *n) : Node(*n->GetLocation()) {
@@ -55,6 +56,7 @@ ClassDecl::ClassDecl(Identifier *n, NamedType *ex, List<NamedType*> *imp, List<D
     cType->SetDeclForType(this);
     convImp = NULL;
     vtable = new List<const char*>;
+    subclasses = new List<ClassDecl*>;
     nextIvarOffset = 4;
 }
 
@@ -64,6 +66,7 @@ void ClassDecl::Check() {
         ReportError::IdentifierNotDeclared(extends->GetId(), LookingForClass);
         extends = NULL;
     }
+    if (ext) ext->subclasses->Append(this);
     for (int i = 0; i < implements->NumElements(); i++) {
         NamedType *in = implements->Nth(i);
         if (!in->IsInterface()) {
@@ -132,6 +135,22 @@ bool ClassDecl::Implements(Type *other) {
     }
     return false;
 }
+/* Method: GetUniqueMethod
+ * -----------------------
+ * Class hierarchy analysis for a call through vtable slot offset on a
+ * receiver whose static type is this class: the object is an instance
+ * of this class or of one below it, so if they all have the same label
+ * in that slot, that is the method the call ends up in. Labels are
+ * interned, so comparing pointers is enough.
+ */
+const char *ClassDecl::GetUniqueMethod(int offset) {
+    Assert(offset >= 0 && offset < vtable->NumElements());
+    const char *label = vtable->Nth(offset);
+    for (int i = 0; i < subclasses->NumElements(); i++)
+        if (subclasses->Nth(i)->GetUniqueMethod(offset) != label) return NULL;
+    return label;
+}
+
 void ClassDecl::Emit(CodeGenerator *cg) {
     members->EmitAll(cg);
     cg->GenVTable(GetName(), vtable);
@@ -272,11 +291,11 @@ const char *FnDecl::GetFunctionLabel()
     if ((cd = dynamic_cast<ClassDecl*>(parent)) != NULL) { // if parent is a class, this is is a method
         char buffer[MaxIdentLen*2+4];
         sprintf(buffer, "_%s.%s", cd->GetName(), id->GetName());
-        return strdup(buffer);
-    } else if (strcmp(id->GetName(), "main")) {
+        return Intern(buffer);
+    } else if (id->GetName() != Intern("main")) {
 	 char buffer[strlen(id->GetName())+2];
 	 sprintf(buffer, "_%s", id->GetName());
-       return strdup(buffer);
+       return Intern(buffer);
     } else
 	return id->GetName();
 }
@@ -69,6 +69,7 @@ class ClassDecl : public Decl
     NamedType *cType;
     List<InterfaceDecl*> *convImp;
     List<const char*> *vtable;
+    List<ClassDecl*> *subclasses;   // those extending this one directly
     int nextIvarOffset;
 
   public:
@@ -87,6 +88,10 @@ class ClassDecl : public Decl
     void AddIvar(VarDecl*d, Decl *p);
     void AddField(Decl*d);
     int GetClassSize() { return nextIvarOffset; }
+    // The label of the method that every object of this class or any
+    // subclass runs for vtable slot offset, or NULL if a subclass
+    // overrides it. Valid once the whole program has been checked.
+    const char *GetUniqueMethod(int offset);
 };
 
 class InterfaceDecl : public Decl 
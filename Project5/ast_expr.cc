@@ -8,13 +8,31 @@
 #include <string.h>
 #include "errors.h"
 #include "codegen.h"
+#include "intern.h"
 
-Type *EmptyExpr::CheckAndComputeResultType() { return Type::voidType; } 
+Type *Expr::CheckAndComputeResultType() {
+    if (!resultType)
+        resultType = ComputeResultType();
+    return resultType;
+}
+
+/* A boolean is 0 or 1, so branching on it being true is branching on
+ * it not being 0.
+ */
+void Expr::EmitBranch(CodeGenerator *cg, const char *label, bool whenTrue) {
+    Emit(cg);
+    if (whenTrue)
+        cg->GenIfCompare(IfCompare::Ne, result, cg->GenLoadConstant(0), label);
+    else
+        cg->GenIfZ(result, label);
+}
+
+Type *EmptyExpr::ComputeResultType() { return Type::voidType; } 
 
 IntConstant::IntConstant(yyltype loc, int val) : Expr(loc) {
     value = val;
 }
-Type *IntConstant::CheckAndComputeResultType() { 
+Type *IntConstant::ComputeResultType() { 
     return Type::intType;
 }
 void IntConstant::Emit(CodeGenerator *cg) { 
@@ -24,14 +42,14 @@ void IntConstant::Emit(CodeGenerator *cg) {
 DoubleConstant::DoubleConstant(yyltype loc, double val) : Expr(loc) {
     value = val;
 }
-Type *DoubleConstant::CheckAndComputeResultType() { 
+Type *DoubleConstant::ComputeResultType() { 
     return Type::doubleType;
 }
 
 BoolConstant::BoolConstant(yyltype loc, bool val) : Expr(loc) {
     value = val;
 }
-Type *BoolConstant::CheckAndComputeResultType() { 
+Type *BoolConstant::ComputeResultType() { 
     return Type::boolType;
 }
 void BoolConstant::Emit(CodeGenerator *cg) { 
@@ -42,13 +60,13 @@ StringConstant::StringConstant(yyltype loc, const char *val) : Expr(loc) {
     Assert(val != NULL);
     value = strdup(val);
 }
-Type *StringConstant::CheckAndComputeResultType() {
+Type *StringConstant::ComputeResultType() {
     return Type::stringType;
 }
 void StringConstant::Emit(CodeGenerator *cg) { 
     result = cg->GenLoadConstant(value);
 }
-Type *NullConstant::CheckAndComputeResultType() { 
+Type *NullConstant::ComputeResultType() { 
     return Type::nullType;
 }
 void NullConstant::Emit(CodeGenerator *cg) { 
@@ -105,7 +123,7 @@ Type *GetResultType(Type *lhs, Type *rhs) {
     return lesser;
 }
 
-Type*ArithmeticExpr::CheckAndComputeResultType() {
+Type*ArithmeticExpr::ComputeResultType() {
     Type *lType = left?left->CheckAndComputeResultType():NULL, *rType = right->CheckAndComputeResultType();
     if (!CanDoArithmetic(lType, rType))
 	ReportErrorForIncompatibleOperands(lType, rType);
@@ -121,7 +139,7 @@ void ArithmeticExpr::Emit(CodeGenerator *cg) {
     }
 }
 
-Type* RelationalExpr::CheckAndComputeResultType() {
+Type* RelationalExpr::ComputeResultType() {
     Type*lhs = left->CheckAndComputeResultType(), *rhs = right->CheckAndComputeResultType();
     if (!CanDoArithmetic(lhs, rhs))
 	ReportErrorForIncompatibleOperands(lhs, rhs);
@@ -144,8 +162,18 @@ void RelationalExpr::Emit(CodeGenerator *cg) {
         result =  cg->GenBinaryOp("||", less, eq);
     }
 }
+void RelationalExpr::EmitBranch(CodeGenerator *cg, const char *label, bool whenTrue) {
+    left->Emit(cg);
+    right->Emit(cg);
+    IfCompare::Condition cond;
+    if (!strcmp(op->str(), "<")) cond = IfCompare::Less;
+    else if (!strcmp(op->str(), ">")) cond = IfCompare::Greater;
+    else if (!strcmp(op->str(), "<=")) cond = IfCompare::LessEq;
+    else cond = IfCompare::GreaterEq;
+    cg->GenIfCompare(whenTrue ? cond : IfCompare::Negate(cond), left->result, right->result, label);
+}
 
-Type* EqualityExpr::CheckAndComputeResultType() {
+Type* EqualityExpr::ComputeResultType() {
    Type*lhs = left->CheckAndComputeResultType(), *rhs = right->CheckAndComputeResultType();
     if (!lhs->IsCompatibleWith(rhs) && !rhs->IsCompatibleWith(lhs))
 	ReportErrorForIncompatibleOperands(lhs, rhs);
@@ -163,25 +191,70 @@ void EqualityExpr::Emit(CodeGenerator *cg) {
         result = cg->GenBinaryOp("==", result, zero);
     }
 }
+void EqualityExpr::EmitBranch(CodeGenerator *cg, const char *label, bool whenTrue) {
+    if (left->CheckAndComputeResultType() == Type::stringType) {
+        Expr::EmitBranch(cg, label, whenTrue);
+        return;
+    }
+    left->Emit(cg);
+    right->Emit(cg);
+    bool equal = (!strcmp(op->str(), "==")) == whenTrue;
+    cg->GenIfCompare(equal ? IfCompare::Eq : IfCompare::Ne, left->result, right->result, label);
+}
 
-Type* LogicalExpr::CheckAndComputeResultType() {
+Type* LogicalExpr::ComputeResultType() {
     Type *lhs = left ?left->CheckAndComputeResultType() :NULL, *rhs = right->CheckAndComputeResultType();
     if ((lhs && !lhs->IsCompatibleWith(Type::boolType)) ||
 	  (!rhs->IsCompatibleWith(Type::boolType)))
 	ReportErrorForIncompatibleOperands(lhs, rhs);
     return Type::boolType;
 }
+/* && and || only evaluate the right operand when the left one does not
+ * already decide the result: the left operand's value goes in result,
+ * and is replaced by the right one's only if it is true for && or false
+ * for ||.
+ */
 void LogicalExpr::Emit(CodeGenerator *cg) {
-    if (left)
-	CompoundExpr::Emit(cg);
-    else {
+    if (left) {
+	const char *done = cg->NewLabel();
+	result = cg->GenTempVar();
+	left->Emit(cg);
+	cg->GenAssign(result, left->result);
+	if (!strcmp(op->str(), "&&"))
+	    cg->GenIfZ(result, done);
+	else
+	    cg->GenIfCompare(IfCompare::Ne, result, cg->GenLoadConstant(0), done);
+	right->Emit(cg);
+	cg->GenAssign(result, right->result);
+	cg->GenLabel(done);
+    } else {
 	right->Emit(cg);
 	Location *zero = cg->GenLoadConstant(0);
 	result = cg->GenBinaryOp("==", right->result, zero);
     }
 }
+/* a && b is false if a is, and a || b true if a is, so the left operand
+ * can jump straight to label in those cases; in the others it jumps past
+ * the right operand's test, which then decides.
+ */
+void LogicalExpr::EmitBranch(CodeGenerator *cg, const char *label, bool whenTrue) {
+    if (!left) {
+	right->EmitBranch(cg, label, !whenTrue);
+	return;
+    }
+    bool isAnd = !strcmp(op->str(), "&&");
+    if (isAnd != whenTrue) {
+	left->EmitBranch(cg, label, whenTrue);
+	right->EmitBranch(cg, label, whenTrue);
+    } else {
+	const char *skip = cg->NewLabel();
+	left->EmitBranch(cg, skip, !whenTrue);
+	right->EmitBranch(cg, label, whenTrue);
+	cg->GenLabel(skip);
+    }
+}
 
-Type * AssignExpr::CheckAndComputeResultType() {
+Type * AssignExpr::ComputeResultType() {
     Type *lhs = left->CheckAndComputeResultType(), *rhs = right->CheckAndComputeResultType();
     if (!rhs->IsCompatibleWith(lhs)) {
         ReportErrorForIncompatibleOperands(lhs, rhs);
@@ -204,7 +277,7 @@ Type * AssignExpr::CheckAndComputeResultType() {
     if (result->IsReference()) 
 	result = cg->GenLoad(result->GetReference(), result->GetRefOffset());
   }
-Type* This::CheckAndComputeResultType() {
+Type* This::ComputeResultType() {
     if (!enclosingClass) enclosingClass = FindSpecificParent<ClassDecl>();
    if (!enclosingClass)  
        ReportError::ThisOutsideClassScope(this);
@@ -212,11 +285,9 @@ Type* This::CheckAndComputeResultType() {
    return enclosingClass->GetDeclaredType();
  }
 
-static Location *ThisLocation = new Location(fpRelative, 4, "this");
-
  void This::Emit(CodeGenerator *cg) {
    if (!result)
-    result = cg->GenThis(ThisLocation);
+    result = cg->GenThis();
  }
  
    
@@ -225,7 +296,7 @@ ArrayAccess::ArrayAccess(yyltype loc, Expr *b, Expr *s) : LValue(loc) {
     (base=b)->SetParent(this); 
     (subscript=s)->SetParent(this);
 }
-Type *ArrayAccess::CheckAndComputeResultType() {
+Type *ArrayAccess::ComputeResultType() {
     Type *baseT = base->CheckAndComputeResultType();
     if ((baseT != Type::errorType) && !baseT->IsArrayType()) 
         ReportError::BracketsOnNonArray(base);
@@ -249,7 +320,7 @@ FieldAccess::FieldAccess(Expr *b, Identifier *f)
 }
 
 
-Type* FieldAccess::CheckAndComputeResultType() {
+Type* FieldAccess::ComputeResultType() {
     Type *baseType = base ? base->CheckAndComputeResultType() : NULL;
     Decl *ivar = field->GetDeclRelativeToBase(baseType);
     if (ivar && ivar->IsIvarDecl() && !base) { // add implicit "this"
@@ -296,7 +367,7 @@ Call::Call(yyltype loc, Expr *b, Identifier *f, List<Expr*> *a) : Expr(loc)  {
     (actuals=a)->SetParentAll(this);
 }
 // special-case code for length() on arrays... sigh.
-Type* Call::CheckAndComputeResultType() {
+Type* Call::ComputeResultType() {
     Type *baseType = base ? base->CheckAndComputeResultType() : NULL;
     FnDecl *fd = dynamic_cast<FnDecl *>(field->GetDeclRelativeToBase(baseType));
     if (fd && fd->IsMethodDecl() && !base) { // add implicit "this"
@@ -309,7 +380,8 @@ Type* Call::CheckAndComputeResultType() {
         aTypes.Append(actuals->Nth(i)->CheckAndComputeResultType());
 // jdz cascade, above loop checks actuals before function confirmed.
 // what about excess actuals? what if function doesn't exist at all?
-    if (baseType && baseType->IsArrayType() && strcmp(field->GetName(), "length") == 0) {
+    static const char *length = Intern("length");
+    if (baseType && baseType->IsArrayType() && field->GetName() == length) {
 	if (actuals->NumElements() != 0) 
             ReportError::NumArgsMismatch(field, 0, actuals->NumElements());
 	return Type::intType;
@@ -356,7 +428,13 @@ void Call::Emit(CodeGenerator *cg)
     FnDecl *func = dynamic_cast<FnDecl *>(field->GetDeclRelativeToBase(baseType));
     if (base) {
         base->Emit(cg);
-        result = cg->GenDynamicDispatch(base->result, func->GetOffset(), &l, !resultType->IsEquivalentTo(Type::voidType));
+        NamedType *nt = dynamic_cast<NamedType*>(baseType);
+        ClassDecl *cd = nt ? dynamic_cast<ClassDecl*>(nt->GetDeclForType()) : NULL;
+        const char *label = cd ? cd->GetUniqueMethod(func->GetOffset()) : NULL;
+        if (label) // no subclass overrides it, so skip the vtable
+            result = cg->GenDirectMethodCall(base->result, label, &l, !resultType->IsEquivalentTo(Type::voidType));
+        else
+            result = cg->GenDynamicDispatch(base->result, func->GetOffset(), &l, !resultType->IsEquivalentTo(Type::voidType));
     } else {
         result = cg->GenFunctionCall(func->GetFunctionLabel(), &l, !resultType->IsEquivalentTo(Type::voidType));
     }
@@ -369,7 +447,7 @@ NewExpr::NewExpr(yyltype loc, NamedType *c) : Expr(loc) {
   (cType=c)->SetParent(this);
 }
 
-Type* NewExpr::CheckAndComputeResultType() {
+Type* NewExpr::ComputeResultType() {
     if (!cType->IsClass()) {
         ReportError::IdentifierNotDeclared(cType->GetId(), LookingForClass);
         return Type::errorType;
@@ -386,7 +464,7 @@ NewArrayExpr::NewArrayExpr(yyltype loc, Expr *sz, Type *et) : Expr(loc) {
     (size=sz)->SetParent(this); 
     (elemType=et)->SetParent(this);
 }
-Type *NewArrayExpr::CheckAndComputeResultType() {
+Type *NewArrayExpr::ComputeResultType() {
     Type *st = size->CheckAndComputeResultType();
     if (!st->IsCompatibleWith(Type::intType))
 	ReportError::NewArraySizeNotInteger(size);
@@ -402,8 +480,8 @@ void NewArrayExpr::Emit(CodeGenerator *cg) {
     result = cg->GenNewArray(size->GetResult());
 }
 
-Type *ReadIntegerExpr::CheckAndComputeResultType() { return Type::intType; }
-Type *ReadLineExpr::CheckAndComputeResultType() { return Type::stringType; }
+Type *ReadIntegerExpr::ComputeResultType() { return Type::intType; }
+Type *ReadLineExpr::ComputeResultType() { return Type::stringType; }
 
 void ReadIntegerExpr::Emit(CodeGenerator *cg) {
     result = cg->GenBuiltInCall(ReadInteger);
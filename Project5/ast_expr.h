@@ -20,15 +20,30 @@ class ClassDecl; // for This
 class Location;
 
 
+/* Each subclass computes its type in ComputeResultType, checking its
+ * subexpressions and reporting any errors on the way. That is done once:
+ * CheckAndComputeResultType caches the answer, so asking again (as
+ * parents and the code generator do) costs nothing and cannot report the
+ * same error twice. */
 class Expr : public Stmt 
 {
+  private:
+    Type *resultType;   // NULL until checked
+
+  protected:
+    virtual Type* ComputeResultType() = 0;
+
   public:
-    Expr(yyltype loc) : Stmt(loc) { result = NULL; }
-    Expr() : Stmt() { result = NULL; }
+    Expr(yyltype loc) : Stmt(loc) { result = NULL; resultType = NULL; }
+    Expr() : Stmt() { result = NULL; resultType = NULL; }
     void Check() { CheckAndComputeResultType(); }
-    virtual Type* CheckAndComputeResultType() = 0;
+    Type* CheckAndComputeResultType();
     Location *result;
     Location *GetResult() { return result; }
+
+      // Emits code that jumps to label if the value is whenTrue and
+      // falls through if not, for the test of an if or a loop
+    virtual void EmitBranch(CodeGenerator *cg, const char *label, bool whenTrue);
 };
 
 /* This node type is used for those places where an expression is optional.
@@ -37,7 +52,7 @@ class Expr : public Stmt
 class EmptyExpr : public Expr
 {
   public:
-    Type* CheckAndComputeResultType();
+    Type* ComputeResultType();
     void Emit(CodeGenerator *cg) { result = NULL; }
 };
 
@@ -48,7 +63,7 @@ class IntConstant : public Expr
   
   public:
     IntConstant(yyltype loc, int val);
-    Type *CheckAndComputeResultType();
+    Type *ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -59,7 +74,7 @@ class DoubleConstant : public Expr
     
   public:
     DoubleConstant(yyltype loc, double val);
-    Type *CheckAndComputeResultType();
+    Type *ComputeResultType();
 };
 
 class BoolConstant : public Expr 
@@ -69,7 +84,7 @@ class BoolConstant : public Expr
     
   public:
     BoolConstant(yyltype loc, bool val);
-    Type *CheckAndComputeResultType();
+    Type *ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -80,7 +95,7 @@ class StringConstant : public Expr
     
   public:
     StringConstant(yyltype loc, const char *val);
-    Type *CheckAndComputeResultType();
+    Type *ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -88,7 +103,7 @@ class NullConstant: public Expr
 {
   public: 
     NullConstant(yyltype loc) : Expr(loc) {}
-    Type *CheckAndComputeResultType();
+    Type *ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -122,7 +137,7 @@ class ArithmeticExpr : public CompoundExpr
   public:
     ArithmeticExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
     ArithmeticExpr(Operator *op, Expr *rhs) : CompoundExpr(op,rhs) {}
-    Type* CheckAndComputeResultType();
+    Type* ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -130,8 +145,9 @@ class RelationalExpr : public CompoundExpr
 {
   public:
     RelationalExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
-    Type* CheckAndComputeResultType();
+    Type* ComputeResultType();
     void Emit(CodeGenerator *cg);
+    void EmitBranch(CodeGenerator *cg, const char *label, bool whenTrue);
 };
 
 class EqualityExpr : public CompoundExpr 
@@ -139,8 +155,9 @@ class EqualityExpr : public CompoundExpr
   public:
     EqualityExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
     const char *GetPrintNameForNode() { return "EqualityExpr"; }
-    Type* CheckAndComputeResultType();
+    Type* ComputeResultType();
     void Emit(CodeGenerator *cg);
+    void EmitBranch(CodeGenerator *cg, const char *label, bool whenTrue);
 };
 
 class LogicalExpr : public CompoundExpr 
@@ -149,8 +166,9 @@ class LogicalExpr : public CompoundExpr
     LogicalExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
     LogicalExpr(Operator *op, Expr *rhs) : CompoundExpr(op,rhs) {}
     const char *GetPrintNameForNode() { return "LogicalExpr"; }
-    Type* CheckAndComputeResultType();
+    Type* ComputeResultType();
     void Emit(CodeGenerator *cg);
+    void EmitBranch(CodeGenerator *cg, const char *label, bool whenTrue);
 };
 
 class AssignExpr : public CompoundExpr 
@@ -158,7 +176,7 @@ class AssignExpr : public CompoundExpr
   public:
     AssignExpr(Expr *lhs, Operator *op, Expr *rhs) : CompoundExpr(lhs,op,rhs) {}
     const char *GetPrintNameForNode() { return "AssignExpr"; }
-    Type* CheckAndComputeResultType();
+    Type* ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -177,7 +195,7 @@ class This : public Expr
     
   public:
     This(yyltype loc) : Expr(loc), enclosingClass(NULL)  {}
-    Type* CheckAndComputeResultType();
+    Type* ComputeResultType();
      void Emit(CodeGenerator *cg);
 };
 
@@ -188,7 +206,7 @@ class ArrayAccess : public LValue
     
   public:
     ArrayAccess(yyltype loc, Expr *base, Expr *subscript);
-    Type *CheckAndComputeResultType();
+    Type *ComputeResultType();
      void EmitWithoutDereference(CodeGenerator *cg);
 };
 
@@ -205,7 +223,7 @@ class FieldAccess : public LValue
     
   public:
     FieldAccess(Expr *base, Identifier *field); //ok to pass NULL base
-    Type* CheckAndComputeResultType();
+    Type* ComputeResultType();
      void EmitWithoutDereference(CodeGenerator *cg);
 };
 
@@ -223,7 +241,7 @@ class Call : public Expr
   public:
     Call(yyltype loc, Expr *base, Identifier *field, List<Expr*> *args);
     Decl *GetFnDecl();
-    Type *CheckAndComputeResultType();
+    Type *ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -234,7 +252,7 @@ class NewExpr : public Expr
     
   public:
     NewExpr(yyltype loc, NamedType *clsType);
-    Type* CheckAndComputeResultType();
+    Type* ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -246,7 +264,7 @@ class NewArrayExpr : public Expr
     
   public:
     NewArrayExpr(yyltype loc, Expr *sizeExpr, Type *elemType);
-    Type* CheckAndComputeResultType();
+    Type* ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -254,7 +272,7 @@ class ReadIntegerExpr : public Expr
 {
   public:
     ReadIntegerExpr(yyltype loc) : Expr(loc) {}
-    Type *CheckAndComputeResultType();
+    Type *ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
@@ -262,7 +280,7 @@ class ReadLineExpr : public Expr
 {
   public:
     ReadLineExpr(yyltype loc) : Expr (loc) {}
-    Type *CheckAndComputeResultType();
+    Type *ComputeResultType();
     void Emit(CodeGenerator *cg);
 };
 
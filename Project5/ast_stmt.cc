@@ -9,6 +9,7 @@
 #include "scope.h"
 #include "errors.h"
 #include "codegen.h"
+#include "intern.h"
 
 
 Program::Program(List<Decl*> *d) {
@@ -23,9 +24,10 @@ void Program::Check() {
 }
 void Program::Emit() {
     bool found = false;
+    const char *main = Intern("main");
     for (int i=0; i < decls->NumElements(); i++) {
 	    Decl *d = decls->Nth(i);
-	    if (!strcmp(d->GetName(), "main") && d->IsFnDecl()) {
+	    if (d->GetName() == main && d->IsFnDecl()) {
 	        found = true;
 	        break;
 	    }
@@ -75,22 +77,20 @@ ForStmt::ForStmt(Expr *i, Expr *t, Expr *s, Stmt *b): LoopStmt(t, b) {
 }
 void ForStmt::Emit(CodeGenerator *cg) {
     init->Emit(cg);
-    char *topLoop = cg->NewLabel();
+    const char *topLoop = cg->NewLabel();
     afterLoopLabel = cg->NewLabel();
     cg->GenLabel(topLoop);
-    test->Emit(cg);
-    cg->GenIfZ(test->result, afterLoopLabel);
+    test->EmitBranch(cg, afterLoopLabel, false);
     body->Emit(cg);
     step->Emit(cg);
     cg->GenGoto(topLoop);
     cg->GenLabel(afterLoopLabel);
 }
 void WhileStmt::Emit(CodeGenerator *cg) {
-    char *topLoop = cg->NewLabel();
+    const char *topLoop = cg->NewLabel();
     afterLoopLabel = cg->NewLabel();
     cg->GenLabel(topLoop);
-    test->Emit(cg);
-    cg->GenIfZ(test->result, afterLoopLabel);
+    test->EmitBranch(cg, afterLoopLabel, false);
     body->Emit(cg);
     cg->GenGoto(topLoop);
     cg->GenLabel(afterLoopLabel);
@@ -106,9 +106,8 @@ void IfStmt::Check() {
     if (elseBody) elseBody->Check();
 }
 void IfStmt::Emit(CodeGenerator *cg) {
-    test->Emit(cg);
-    char *afterElse, *elseL = cg->NewLabel();
-    cg->GenIfZ(test->result, elseL);
+    const char *afterElse, *elseL = cg->NewLabel();
+    test->EmitBranch(cg, elseL, false);
     body->Emit(cg);
     if (elseBody) {
 	    afterElse = cg->NewLabel();
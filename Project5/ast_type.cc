@@ -85,7 +85,7 @@ bool NamedType::IsClass() {
 
 bool NamedType::IsEquivalentTo(Type *other) {
     NamedType *ot = dynamic_cast<NamedType*>(other);
-    return ot && strcmp(id->GetName(), ot->id->GetName()) == 0;
+    return ot && id->GetName() == ot->id->GetName();
 }
 
 bool NamedType::IsCompatibleWith(Type *other) {
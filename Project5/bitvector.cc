@@ -0,0 +1,80 @@
+/* File: bitvector.cc
+ * ------------------
+ * Implementation of the word-packed BitVector set.
+ */
+
+#include "bitvector.h"
+
+
+void BitVector::Resize(int n)
+{
+    numBits = n;
+    words.resize(NumWordsFor(n), 0);
+    if (n % BitsPerWord) // mask off bits past the end in the last word
+        words.back() &= ((Word)1 << (n % BitsPerWord)) - 1;
+}
+
+void BitVector::Clear()
+{
+    for (int w = 0; w < (int)words.size(); w++)
+        words[w] = 0;
+}
+
+void BitVector::ResetRange(int from, int to)
+{
+    Assert(from >= 0 && from <= to && to <= numBits);
+    while (from < to && from % BitsPerWord)
+        Reset(from++);
+    for (; from + BitsPerWord <= to; from += BitsPerWord)
+        words[from / BitsPerWord] = 0;
+    while (from < to)
+        Reset(from++);
+}
+
+bool BitVector::UnionWith(const BitVector &other)
+{
+    Assert(numBits == other.numBits);
+    Word changed = 0;
+    for (int w = 0; w < (int)words.size(); w++) {
+        Word merged = words[w] | other.words[w];
+        changed |= merged ^ words[w];
+        words[w] = merged;
+    }
+    return changed != 0;
+}
+
+void BitVector::IntersectWith(const BitVector &other)
+{
+    Assert(numBits == other.numBits);
+    for (int w = 0; w < (int)words.size(); w++)
+        words[w] &= other.words[w];
+}
+
+void BitVector::Subtract(const BitVector &other)
+{
+    Assert(numBits == other.numBits);
+    for (int w = 0; w < (int)words.size(); w++)
+        words[w] &= ~other.words[w];
+}
+
+int BitVector::NextSetBit(int from) const
+{
+    if (from >= numBits) return -1;
+    int w = from / BitsPerWord;
+    Word cur = words[w] & (~(Word)0 << (from % BitsPerWord));
+    while (true) {
+        if (cur)
+            return w * BitsPerWord + __builtin_ctzl(cur);
+        if (++w == (int)words.size())
+            return -1;
+        cur = words[w];
+    }
+}
+
+int BitVector::Count() const
+{
+    int count = 0;
+    for (int w = 0; w < (int)words.size(); w++)
+        count += __builtin_popcountl(words[w]);
+    return count;
+}
@@ -0,0 +1,75 @@
+/* File: bitvector.h
+ * -----------------
+ * A BitVector is a fixed-size set of small non-negative integers
+ * (0 .. NumBits()-1) packed into machine words. It is the set
+ * representation used by the dataflow analyses: each variable in a
+ * function is given a dense number, and the in/out/gen/kill sets of
+ * every node are BitVectors of that size, so set union and difference
+ * are a handful of word operations instead of tree-node allocations.
+ *
+ * Sample usage, visiting every member of a set:
+ *
+ *       for (int i = set.NextSetBit(0); i != -1; i = set.NextSetBit(i+1))
+ *           printf("%d is in the set\n", i);
+ */
+
+#ifndef _H_bitvector
+#define _H_bitvector
+
+#include <vector>
+#include "utility.h"  // for Assert()
+
+class BitVector {
+
+  private:
+    typedef unsigned long Word;
+    static const int BitsPerWord = sizeof(Word) * 8;
+
+    int numBits;
+    std::vector<Word> words;
+
+    static int NumWordsFor(int bits) { return (bits + BitsPerWord - 1) / BitsPerWord; }
+
+  public:
+           // Create a new empty set able to hold members 0..numBits-1
+    BitVector(int numBits = 0) : numBits(numBits), words(NumWordsFor(numBits), 0) {}
+
+           // Change the capacity, members beyond the new size are dropped
+    void Resize(int numBits);
+
+    int NumBits() const { return numBits; }
+
+           // Removes all members
+    void Clear();
+
+    void Set(int i)
+        { Assert(i >= 0 && i < numBits);
+          words[i / BitsPerWord] |= (Word)1 << (i % BitsPerWord); }
+    void Reset(int i)
+        { Assert(i >= 0 && i < numBits);
+          words[i / BitsPerWord] &= ~((Word)1 << (i % BitsPerWord)); }
+    bool Test(int i) const
+        { Assert(i >= 0 && i < numBits);
+          return (words[i / BitsPerWord] >> (i % BitsPerWord)) & 1; }
+
+          // Removes the members from..to-1
+    void ResetRange(int from, int to);
+
+          // Set operations on vectors of the same size. UnionWith returns
+          // true if any member was added, which is what a fixpoint loop
+          // needs to know.
+    bool UnionWith(const BitVector &other);
+    void IntersectWith(const BitVector &other);
+    void Subtract(const BitVector &other);
+
+    bool operator==(const BitVector &other) const { return words == other.words; }
+    bool operator!=(const BitVector &other) const { return words != other.words; }
+
+          // Returns the smallest member >= from, or -1 if there is none
+    int NextSetBit(int from) const;
+
+          // Returns number of members
+    int Count() const;
+};
+
+#endif
@@ -0,0 +1,287 @@
+/* File: bounds.cc
+ * ---------------
+ * Array bounds-check elimination over the TAC of one function.
+ */
+
+#include "optimize.h"
+#include "cfg.h"
+#include "codegen.h"
+#include "dataflow.h"
+#include "liveness.h"
+#include "tac.h"
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+typedef std::unordered_set<Location*> VarSet;
+
+
+/* Function: WritesNonNegative
+ * ---------------------------
+ * Returns true if tac certainly writes a value >= 0, given that the
+ * variables in nonNegative hold one. Constants, comparisons, array
+ * lengths, and sums, quotients, remainders and bitwise and/or of such
+ * values qualify; add traps on overflow rather than wrapping round to
+ * a negative, but a product can wrap.
+ */
+static bool WritesNonNegative(Instruction *tac, const VarSet &nonNegative)
+{
+    if (LoadConstant *load = dynamic_cast<LoadConstant*> (tac))
+        return load-> GetValue() >= 0;
+    if (Load *load = dynamic_cast<Load*> (tac))
+        return load-> GetOffset() == CodeGenerator::OffsetToArrayLength;
+    if (BinaryOp *op = dynamic_cast<BinaryOp*> (tac)) {
+        BinaryOp::OpCode code = op-> GetOpCode();
+        if (code == BinaryOp::Eq || code == BinaryOp::Less) return true;
+        if (code == BinaryOp::Sub || code == BinaryOp::Mul) return false;
+    } else if (!dynamic_cast<Assign*> (tac))
+        return false;
+    Location *gen[Instruction::MaxGen];
+    int numGen = tac-> GetGen(gen);
+    for (int j = 0; j < numGen; j++)
+        if (!nonNegative.count(gen[j])) return false;
+    return true;
+}
+
+/* Function: FindNonNegative
+ * -------------------------
+ * Fills nonNegative with the frame variables that only ever hold values
+ * >= 0: every write to one qualifies by WritesNonNegative, and it is not
+ * read before being written, which would see its garbage or argument.
+ * The set starts with every candidate and loses the ones a write
+ * disqualifies until nothing changes.
+ */
+static void FindNonNegative(FlowGraph *graph, VarSet *nonNegative)
+{
+    Liveness liveness(graph);
+    const BitVector &atEntry = liveness.LiveIn(graph-> Entry());
+    std::unordered_map<Location*, std::vector<Instruction*> > defs;
+    for (int b = 0; b < graph-> NumBlocks(); b++) {
+        List<Instruction*> *tacs = &graph-> Block(b)-> code;
+        for (int i = 0; i < tacs-> NumElements(); i++) {
+            Location *kill = tacs-> Nth(i)-> GetKill();
+            if (kill && kill-> GetSegment() == fpRelative)
+                defs[kill].push_back(tacs-> Nth(i));
+        }
+    }
+    std::unordered_map<Location*, std::vector<Instruction*> >::iterator it;
+    for (it = defs.begin(); it != defs.end(); ++it)
+        if (!atEntry.Test(liveness.IndexOf(it-> first))) nonNegative-> insert(it-> first);
+
+    for (bool changed = true; changed; ) {
+        changed = false;
+        for (it = defs.begin(); it != defs.end(); ++it) {
+            if (!nonNegative-> count(it-> first)) continue;
+            for (int i = 0; i < (int)it-> second.size(); i++) {
+                if (!WritesNonNegative(it-> second[i], *nonNegative)) {
+                    nonNegative-> erase(it-> first);
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+
+/* Class: CheckedBounds
+ * --------------------
+ * Solves for the pairs (index, count) known to satisfy 0 <= index <
+ * count at each point: on every path from the entry something
+ * established it and neither variable has been written since. Only the
+ * pairs that some IfInBounds tests are tracked. A pair is established
+ * by an IfInBounds on it, which is only passed when it holds, and on
+ * entry to a block reached only by falling through a test that fails
+ * unless index < count, as a loop's body is from its test, when index
+ * cannot be negative.
+ *
+ * As for available copies, the solver only takes unions, so what it
+ * works out is the pairs that may not hold.
+ */
+class CheckedBounds {
+  private:
+    std::map<std::pair<Location*, Location*>, int> pairIndex;
+    std::unordered_map<Location*, std::vector<int> > touching;
+    std::vector<int> tested;                // by block id, pair known on entry or -1
+    BitVector entryIn;
+    Dataflow *solution;
+
+    int PairOf(Location *index, Location *count) const;
+    int TestedOnEntry(BasicBlock *block, const VarSet &nonNegative) const;
+
+  public:
+    CheckedBounds(FlowGraph *graph, const VarSet &nonNegative);
+    ~CheckedBounds()                    { delete solution; }
+
+    int PairOf(IfInBounds *check) const { return PairOf(check-> GetIndex(), check-> GetCount()); }
+
+          // The pairs that may not hold on entry to block, past the
+          // start of it
+    BitVector NotIn(BasicBlock *block) const;
+
+          // Turns the set that may not hold before tac into the set
+          // after it
+    void StepForward(Instruction *tac, BitVector *notHeld) const;
+};
+
+CheckedBounds::CheckedBounds(FlowGraph *graph, const VarSet &nonNegative)
+{
+    for (int b = 0; b < graph-> NumBlocks(); b++) {
+        List<Instruction*> *tacs = &graph-> Block(b)-> code;
+        for (int i = 0; i < tacs-> NumElements(); i++) {
+            IfInBounds *check = dynamic_cast<IfInBounds*> (tacs-> Nth(i));
+            if (!check || PairOf(check) != -1) continue;
+            int p = pairIndex.size();
+            pairIndex[std::make_pair(check-> GetIndex(), check-> GetCount())] = p;
+            touching[check-> GetIndex()].push_back(p);
+            if (check-> GetCount() != check-> GetIndex())
+                touching[check-> GetCount()].push_back(p);
+        }
+    }
+    entryIn.Resize(pairIndex.size());
+    for (int p = 0; p < (int)pairIndex.size(); p++)
+        entryIn.Set(p);
+    tested.resize(graph-> NumBlocks());
+    for (int b = 0; b < graph-> NumBlocks(); b++)
+        tested[b] = TestedOnEntry(graph-> Block(b), nonNegative);
+
+    solution = new Dataflow(graph-> NumBlocks(), pairIndex.size(), Dataflow::Forward);
+    BitVector held(pairIndex.size());
+    for (int b = 0; b < graph-> NumBlocks(); b++) {
+        BasicBlock *block = graph-> Block(b);
+        for (int j = 0; j < block-> succs.NumElements(); j++)
+            solution-> AddEdge(b, block-> succs.Nth(j)-> id);
+        BitVector *blockGen = solution-> Gen(b), *blockKill = solution-> Kill(b);
+        if (block == graph-> Entry())
+            *blockGen = entryIn;
+        held.Clear();
+        if (tested[b] != -1) {
+            blockGen-> Reset(tested[b]);
+            held.Set(tested[b]);
+        }
+        for (int i = 0; i < block-> code.NumElements(); i++) {
+            Instruction *instr = block-> code.Nth(i);
+            StepForward(instr, blockGen);
+            if (Location *kill = instr-> GetKill()) {
+                std::unordered_map<Location*, std::vector<int> >::const_iterator found = touching.find(kill);
+                if (found != touching.end())
+                    for (int k = 0; k < (int)found-> second.size(); k++)
+                        held.Reset(found-> second[k]);
+            }
+            if (IfInBounds *check = dynamic_cast<IfInBounds*> (instr))
+                held.Set(PairOf(check));
+        }
+        *blockKill = held;
+    }
+    solution-> Solve();
+}
+
+int CheckedBounds::PairOf(Location *index, Location *count) const
+{
+    std::map<std::pair<Location*, Location*>, int>::const_iterator found =
+        pairIndex.find(std::make_pair(index, count));
+    return found == pairIndex.end() ? -1 : found-> second;
+}
+
+/* Method: TestedOnEntry
+ * ---------------------
+ * Returns the pair known to hold on entry to block because its only
+ * way in is falling through an IfCompare that branches away when
+ * index >= count (or count <= index), or through an IfZ on t, where
+ * t = index < count is computed earlier in the same block and neither
+ * operand is written between there and the IfZ; or -1 if there is
+ * none.
+ */
+int CheckedBounds::TestedOnEntry(BasicBlock *block, const VarSet &nonNegative) const
+{
+    if (block-> preds.NumElements() != 1) return -1;
+    BasicBlock *pred = block-> preds.Nth(0);
+    IfZ *ifz = dynamic_cast<IfZ*> (pred-> Last());
+    IfCompare *cmp = dynamic_cast<IfCompare*> (pred-> Last());
+    Label *label = dynamic_cast<Label*> (block-> First());
+    if ((!ifz && !cmp) || pred-> id != block-> id - 1 ||
+        (label && label-> GetLabel() == (ifz ? ifz-> GetLabel() : cmp-> GetLabel())))
+        return -1;
+
+    Location *test, *gen[Instruction::MaxGen];
+    if (cmp) {
+        cmp-> GetGen(gen);
+        if (cmp-> GetCondition() == IfCompare::LessEq) std::swap(gen[0], gen[1]);
+        else if (cmp-> GetCondition() != IfCompare::GreaterEq) return -1;
+        return nonNegative.count(gen[0]) ? PairOf(gen[0], gen[1]) : -1;
+    }
+    ifz-> GetGen(&test);
+    VarSet written;
+    for (int i = pred-> code.NumElements() - 2; i >= 0; i--) {
+        Instruction *instr = pred-> code.Nth(i);
+        Location *kill = instr-> GetKill();
+        if (kill != test) {
+            if (kill) written.insert(kill);
+            continue;
+        }
+        BinaryOp *op = dynamic_cast<BinaryOp*> (instr);
+        if (!op || op-> GetOpCode() != BinaryOp::Less) return -1;
+        op-> GetGen(gen);
+        if (!nonNegative.count(gen[0]) || written.count(gen[0]) || written.count(gen[1]))
+            return -1;
+        return PairOf(gen[0], gen[1]);
+    }
+    return -1;
+}
+
+BitVector CheckedBounds::NotIn(BasicBlock *block) const
+{
+    BitVector notHeld = (block-> id == 0) ? entryIn : solution-> In(block-> id);
+    if (tested[block-> id] != -1) notHeld.Reset(tested[block-> id]);
+    return notHeld;
+}
+
+void CheckedBounds::StepForward(Instruction *tac, BitVector *notHeld) const
+{
+    if (Location *kill = tac-> GetKill()) {
+        std::unordered_map<Location*, std::vector<int> >::const_iterator found = touching.find(kill);
+        if (found != touching.end())
+            for (int k = 0; k < (int)found-> second.size(); k++)
+                notHeld-> Set(found-> second[k]);
+    }
+    if (IfInBounds *check = dynamic_cast<IfInBounds*> (tac))
+        notHeld-> Reset(PairOf(check));
+}
+
+
+/* Function: RemoveBoundsChecks
+ * ----------------------------
+ * Each IfInBounds on a pair already known to hold becomes a Goto past
+ * its error path, which can then no longer be reached and goes when
+ * the function is put back together.
+ */
+bool RemoveBoundsChecks(List<Instruction*> *tac)
+{
+    bool any = false;
+    for (int i = 0; i < tac-> NumElements() && !any; i++)
+        any = (dynamic_cast<IfInBounds*> (tac-> Nth(i)) != NULL);
+    if (!any) return false;
+
+    FlowGraph graph(tac, 0, tac-> NumElements() - 1);
+    VarSet nonNegative;
+    FindNonNegative(&graph, &nonNegative);
+    CheckedBounds checked(&graph, nonNegative);
+    bool changed = false;
+    for (int b = 0; b < graph.NumBlocks(); b++) {
+        BasicBlock *block = graph.Block(b);
+        BitVector notHeld = checked.NotIn(block);
+        for (int i = 0; i < block-> code.NumElements(); i++) {
+            IfInBounds *check = dynamic_cast<IfInBounds*> (block-> code.Nth(i));
+            if (check && !notHeld.Test(checked.PairOf(check))) {
+                block-> code.RemoveAt(i);
+                block-> code.InsertAt(new Goto(check-> GetLabel()), i);
+                changed = true;
+                continue;
+            }
+            checked.StepForward(block-> code.Nth(i), &notHeld);
+        }
+    }
+    Relayout(&graph, tac);
+    return changed;
+}
@@ -0,0 +1,84 @@
+/* File: callsite.cc
+ * -----------------
+ * Implementation of the helpers for passes that work on calls.
+ */
+
+#include "callsite.h"
+#include "tac.h"
+#include <unordered_set>
+
+
+bool MatchCall(List<Instruction*> *code, int first, CallSite *site)
+{
+    site-> first = first;
+    for (int n = 0; n < CodeGenerator::NumRegParams; n++)
+        site-> inReg[n] = NULL;
+    site-> pushed.clear();
+    int i = first + 1;
+    for (; i < code-> NumElements(); i++) {
+        Location *param;
+        if (PushParam *push = dynamic_cast<PushParam*> (code-> Nth(i))) {
+            push-> GetGen(&param);
+            site-> pushed.push_back(param);
+        } else if (RegParam *reg = dynamic_cast<RegParam*> (code-> Nth(i))) {
+            reg-> GetGen(&param);
+            site-> inReg[reg-> GetRegister()] = param;
+        } else
+            break;
+    }
+    if (i >= code-> NumElements()) return false;
+    LCall *lcall = dynamic_cast<LCall*> (code-> Nth(i));
+    ACall *acall = dynamic_cast<ACall*> (code-> Nth(i));
+    if (!lcall && !acall) return false;
+    site-> call = i;
+    site-> label = lcall ? lcall-> GetLabel() : NULL;
+    site-> addr = NULL;
+    if (acall) acall-> GetGen(&site-> addr);
+    site-> result = code-> Nth(i)-> GetKill();
+    if (++i < code-> NumElements() && dynamic_cast<PopParams*> (code-> Nth(i))) i++;
+    if (i >= code-> NumElements() || !dynamic_cast<CallerLoad*> (code-> Nth(i))) return false;
+    site-> last = i;
+    return true;
+}
+
+bool IsFormal(Location *var)
+{
+    return var-> GetSegment() == fpRelative &&
+        (var-> GetArgRegister() != -1 || var-> GetOffset() >= CodeGenerator::OffsetToFirstParam);
+}
+
+void FindFormals(List<Instruction*> *code, std::vector<Location*> *formals)
+{
+    formals-> clear();
+    std::unordered_set<Location*> seen;
+    for (int i = 0; i < code-> NumElements(); i++) {
+        Instruction *instr = code-> Nth(i);
+        Location *vars[Instruction::MaxGen + 1];
+        int numVars = instr-> GetGen(vars);
+        if ((vars[numVars] = instr-> GetKill()) != NULL) numVars++;
+        for (int j = 0; j < numVars; j++)
+            if (IsFormal(vars[j]) && seen.insert(vars[j]).second)
+                formals-> push_back(vars[j]);
+    }
+}
+
+/* Function: ArgumentFor
+ * ---------------------
+ * A formal arriving in $a<n> gets what the call's RegParam for n
+ * passes; one on the stack, what was pushed into its slot, the last
+ * parameter pushed being the one at fp+4.
+ */
+Location *ArgumentFor(Location *formal, const CallSite &site)
+{
+    if (formal-> GetArgRegister() != -1)
+        return site.inReg[formal-> GetArgRegister()];
+    int k = (formal-> GetOffset() - CodeGenerator::OffsetToFirstParam) / CodeGenerator::VarSize;
+    return k < (int)site.pushed.size() ? site.pushed[site.pushed.size() - 1 - k] : NULL;
+}
+
+Location *NewFrameVariable(BeginFunc *frame, const char *name)
+{
+    int size = frame-> GetFrameSize();
+    frame-> SetFrameSize(size + CodeGenerator::VarSize);
+    return new Location(fpRelative, CodeGenerator::OffsetToFirstLocal - size, name);
+}
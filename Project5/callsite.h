@@ -0,0 +1,77 @@
+/* File: callsite.h
+ * ----------------
+ * What the passes that work on calls between Decaf functions share:
+ * picking out the TACs of one call, matching what it passes to the
+ * callee's formals, and giving a function new frame variables.
+ */
+
+#ifndef _H_callsite
+#define _H_callsite
+
+#include "list.h"
+#include "codegen.h"
+#include <vector>
+
+class Instruction;
+class Location;
+class BeginFunc;
+
+
+  // The TACs of a call as GenFunctionCall, GenMethodCall and
+  // GenDirectMethodCall lay them out: CallerSave, the parameters, the
+  // LCall or ACall, PopParams if any were pushed, and CallerLoad
+struct CallSite {
+    int first, call, last;              // CallerSave, LCall/ACall, CallerLoad
+    const char *label;                  // called, or NULL for an ACall
+    Location *addr;                     // called, for an ACall
+    Location *result;
+    std::vector<Location*> pushed;      // in the order pushed
+    Location *inReg[CodeGenerator::NumRegParams];
+};
+
+
+/* Function: MatchCall()
+ * Usage: if (MatchCall(&tac, i, &site)) ...
+ * -----------------------------------------
+ * Returns true if the CallerSave at code[first] starts a call laid out
+ * as above, filling in site.
+ */
+bool MatchCall(List<Instruction*> *code, int first, CallSite *site);
+
+
+/* Function: IsFormal()
+ * Usage: if (IsFormal(var)) ...
+ * -----------------------------
+ * Returns true if var is a formal of the function it belongs to,
+ * "this" included.
+ */
+bool IsFormal(Location *var);
+
+
+/* Function: FindFormals()
+ * Usage: FindFormals(&tac, &formals);
+ * -----------------------------------
+ * Fills formals with those of the function in code that its TACs use,
+ * each once.
+ */
+void FindFormals(List<Instruction*> *code, std::vector<Location*> *formals);
+
+
+/* Function: ArgumentFor()
+ * Usage: arg = ArgumentFor(formal, site);
+ * ---------------------------------------
+ * Returns what the call passes for a formal of the function it calls,
+ * or NULL if it passes nothing there.
+ */
+Location *ArgumentFor(Location *formal, const CallSite &site);
+
+
+/* Function: NewFrameVariable()
+ * Usage: var = NewFrameVariable(frame, "x");
+ * ------------------------------------------
+ * Returns a new variable in a slot of its own at the bottom of the
+ * frame of the function frame begins, which grows to hold it.
+ */
+Location *NewFrameVariable(BeginFunc *frame, const char *name);
+
+#endif
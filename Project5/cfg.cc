@@ -0,0 +1,236 @@
+/* File: cfg.cc
+ * ------------
+ * Implementation of basic blocks and the per-function flow graph.
+ */
+
+#include "cfg.h"
+#include "tac.h"
+#include "hashtable.h"
+#include "intern.h"
+
+
+FlowGraph::FlowGraph(List<Instruction*> *tac, int begin, int end)
+{
+    FindBlocks(tac, begin, end);
+    LinkBlocks();
+    NumberBlocks();
+    ComputeDominators();
+    FindLoops();
+}
+
+FlowGraph::~FlowGraph()
+{
+    for (int i = 0; i < (int)blocks.size(); i++)
+        delete blocks[i];
+}
+
+
+/* Method: FindBlocks
+ * ------------------
+ * Splits tac[begin..end] into blocks at its leaders: the first TAC,
+ * every Label, and every TAC that follows a branch, Return or TailCall.
+ */
+void FlowGraph::FindBlocks(List<Instruction*> *tac, int begin, int end)
+{
+    BasicBlock *current = NULL;
+    bool leader = true;
+    for (int i = begin; i <= end; i++) {
+        Instruction *instr = tac-> Nth(i);
+        if (leader || dynamic_cast<Label*> (instr)) {
+            current = new BasicBlock(blocks.size());
+            blocks.push_back(current);
+        }
+        current-> code.Append(instr);
+        leader = dynamic_cast<Goto*> (instr) || dynamic_cast<IfZ*> (instr) ||
+                 dynamic_cast<IfCompare*> (instr) || dynamic_cast<IfInBounds*> (instr) ||
+                 dynamic_cast<Return*> (instr) || dynamic_cast<TailCall*> (instr);
+    }
+}
+
+/* Function: CallsHalt
+ * -------------------
+ * Returns true if the block calls _Halt, which the runtime error checks
+ * do after printing their message. Nothing after that call runs, so
+ * such a block does not fall through to the next.
+ */
+static bool CallsHalt(BasicBlock *block)
+{
+    static const char *halt = Intern("_Halt");
+    for (int i = block-> code.NumElements() - 1; i >= 0; i--) {
+        LCall *call = dynamic_cast<LCall*> (block-> code.Nth(i));
+        if (call && call-> GetLabel() == halt) return true;
+    }
+    return false;
+}
+
+/* Method: LinkBlocks
+ * ------------------
+ * Adds the edges out of each block, decided by its last TAC (or by a
+ * call to _Halt in it). Labels can only start a block, so the label
+ * table maps each label straight to the block it names.
+ */
+void FlowGraph::LinkBlocks()
+{
+    Hashtable<BasicBlock*> labels;
+    for (int i = 0; i < (int)blocks.size(); i++) {
+        if (Label *label = dynamic_cast<Label*> (blocks[i]-> First()))
+            labels.Enter(label-> GetLabel(), blocks[i]);
+    }
+
+    for (int i = 0; i < (int)blocks.size(); i++) {
+        BasicBlock *block = blocks[i], *target = NULL, *next = NULL;
+        Instruction *last = block-> Last();
+        if (i + 1 < (int)blocks.size())
+            next = blocks[i + 1];
+        if (Goto *gt = dynamic_cast<Goto*> (last)) {
+            target = labels.Lookup(gt-> GetLabel());
+            next = NULL;
+        } else if (IfZ *ifz = dynamic_cast<IfZ*> (last)) {
+            target = labels.Lookup(ifz-> GetLabel());
+        } else if (IfCompare *cmp = dynamic_cast<IfCompare*> (last)) {
+            target = labels.Lookup(cmp-> GetLabel());
+        } else if (IfInBounds *check = dynamic_cast<IfInBounds*> (last)) {
+            target = labels.Lookup(check-> GetLabel());
+        } else if (dynamic_cast<Return*> (last) || dynamic_cast<TailCall*> (last) ||
+                   dynamic_cast<EndFunc*> (last) || CallsHalt(block)) {
+            next = NULL;
+        }
+        if (target) {
+            block-> succs.Append(target);
+            target-> preds.Append(block);
+        }
+        if (next && next != target) {
+            block-> succs.Append(next);
+            next-> preds.Append(block);
+        }
+    }
+}
+
+/* Method: NumberBlocks
+ * --------------------
+ * Depth-first walk from the entry; the reverse of the order in which
+ * blocks finish is their reverse postorder. Blocks the walk never
+ * reaches are dead code and keep rpo -1.
+ */
+void FlowGraph::NumberBlocks()
+{
+    std::vector<BasicBlock*> postorder;
+    std::vector<char> visited(blocks.size(), false);
+    std::vector<std::pair<BasicBlock*, int> > stack; // (block, next successor to try)
+    visited[0] = true;
+    stack.push_back(std::make_pair(blocks[0], 0));
+    while (!stack.empty()) {
+        BasicBlock *block = stack.back().first;
+        int &next = stack.back().second;
+        if (next < block-> succs.NumElements()) {
+            BasicBlock *s = block-> succs.Nth(next++);
+            if (!visited[s-> id]) {
+                visited[s-> id] = true;
+                stack.push_back(std::make_pair(s, 0));
+            }
+        } else {
+            postorder.push_back(block);
+            stack.pop_back();
+        }
+    }
+    order.assign(postorder.rbegin(), postorder.rend());
+    for (int k = 0; k < (int)order.size(); k++)
+        order[k]-> rpo = k;
+}
+
+/* Method: ComputeDominators
+ * -------------------------
+ * Finds immediate dominators with the iterative algorithm of Cooper,
+ * Harvey and Kennedy: each reachable block's idom is the common
+ * ancestor of its processed predecessors, repeated in reverse postorder
+ * until nothing changes. The tree is then walked once to number each
+ * block on entry and exit, which makes Dominates a constant time test.
+ */
+void FlowGraph::ComputeDominators()
+{
+    BasicBlock *entry = blocks[0];
+    entry-> idom = entry;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int k = 1; k < (int)order.size(); k++) {
+            BasicBlock *block = order[k], *idom = NULL;
+            for (int i = 0; i < block-> preds.NumElements(); i++) {
+                BasicBlock *p = block-> preds.Nth(i);
+                if (p-> idom == NULL) continue; // not processed yet (or unreachable)
+                if (idom == NULL) { idom = p; continue; }
+                BasicBlock *a = p, *b = idom;
+                while (a != b) {
+                    while (a-> rpo > b-> rpo) a = a-> idom;
+                    while (b-> rpo > a-> rpo) b = b-> idom;
+                }
+                idom = a;
+            }
+            if (idom != block-> idom) {
+                block-> idom = idom;
+                changed = true;
+            }
+        }
+    }
+    entry-> idom = NULL;
+
+    for (int k = 1; k < (int)order.size(); k++)
+        order[k]-> idom-> domChildren.Append(order[k]);
+
+    int counter = 0;
+    std::vector<std::pair<BasicBlock*, int> > stack;
+    entry-> domEnter = counter++;
+    stack.push_back(std::make_pair(entry, 0));
+    while (!stack.empty()) {
+        BasicBlock *block = stack.back().first;
+        int &next = stack.back().second;
+        if (next < block-> domChildren.NumElements()) {
+            BasicBlock *child = block-> domChildren.Nth(next++);
+            child-> domEnter = counter++;
+            stack.push_back(std::make_pair(child, 0));
+        } else {
+            block-> domExit = counter++;
+            stack.pop_back();
+        }
+    }
+}
+
+bool FlowGraph::Dominates(BasicBlock *a, BasicBlock *b) const
+{
+    if (!a-> IsReachable() || !b-> IsReachable()) return false;
+    return a-> domEnter <= b-> domEnter && b-> domExit <= a-> domExit;
+}
+
+/* Method: FindLoops
+ * -----------------
+ * Every back edge (an edge whose target dominates its source) closes a
+ * natural loop: the header plus every block that reaches the source
+ * without going through the header. Loops with the same header are
+ * taken as one, and each block's depth is the number of loops it is in.
+ */
+void FlowGraph::FindLoops()
+{
+    std::vector<int> inLoop(blocks.size(), -1); // header last counted for
+    std::vector<BasicBlock*> work;
+    for (int k = 0; k < (int)order.size(); k++) {
+        BasicBlock *header = order[k];
+        for (int i = 0; i < header-> preds.NumElements(); i++) {
+            BasicBlock *tail = header-> preds.Nth(i);
+            if (!Dominates(header, tail)) continue;
+            if (inLoop[header-> id] != header-> id) {
+                inLoop[header-> id] = header-> id;
+                header-> loopDepth++;
+            }
+            work.push_back(tail);
+            while (!work.empty()) {
+                BasicBlock *block = work.back();
+                work.pop_back();
+                if (inLoop[block-> id] == header-> id) continue;
+                inLoop[block-> id] = header-> id;
+                block-> loopDepth++;
+                for (int j = 0; j < block-> preds.NumElements(); j++)
+                    work.push_back(block-> preds.Nth(j));
+            }
+        }
+    }
+}
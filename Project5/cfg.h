@@ -0,0 +1,77 @@
+/* File: cfg.h
+ * -----------
+ * The FlowGraph class divides the TAC of one function into basic
+ * blocks and links them into a control flow graph. A block starts at a
+ * leader (the BeginFunc, a Label, or the TAC after a branch or return)
+ * and holds the straight-line run of TAC up to the next leader. Branch
+ * targets are resolved to blocks once, while the graph is built, so
+ * analyses never look up labels again. A block that calls _Halt has no
+ * successors.
+ *
+ * Besides the edges, the graph numbers the reachable blocks in reverse
+ * postorder (the order forward dataflow problems want to visit them),
+ * builds the dominator tree over them and finds the natural loops (an
+ * edge to a block that dominates its source closes a loop) to give each
+ * block its loop nesting depth.
+ */
+
+#ifndef _H_cfg
+#define _H_cfg
+
+#include <vector>
+#include "list.h"
+
+class Instruction;
+
+class BasicBlock {
+  public:
+    int id;                         // position in layout order
+    List<Instruction*> code;        // the TAC of the block, in order
+    List<BasicBlock*> preds, succs;
+
+    int rpo;                        // reverse postorder number, -1 if unreachable
+    BasicBlock *idom;               // immediate dominator, NULL for entry/unreachable
+    List<BasicBlock*> domChildren;  // blocks this one immediately dominates
+    int loopDepth;                  // number of loops the block is in
+
+    BasicBlock(int n) : id(n), rpo(-1), idom(NULL), loopDepth(0), domEnter(0), domExit(0) {}
+
+    Instruction *First()    { return code.Nth(0); }
+    Instruction *Last()     { return code.Nth(code.NumElements() - 1); }
+    bool IsReachable()      { return rpo != -1; }
+
+  private:
+    friend class FlowGraph;
+    int domEnter, domExit;          // dominator tree walk numbering
+};
+
+class FlowGraph {
+  private:
+    std::vector<BasicBlock*> blocks;
+    std::vector<BasicBlock*> order; // reachable blocks in reverse postorder
+
+    void FindBlocks(List<Instruction*> *tac, int begin, int end);
+    void LinkBlocks();
+    void NumberBlocks();
+    void ComputeDominators();
+    void FindLoops();
+
+  public:
+          // Builds the graph of the function in tac[begin..end], which
+          // must run from its BeginFunc to its EndFunc.
+    FlowGraph(List<Instruction*> *tac, int begin, int end);
+    ~FlowGraph();
+
+    int NumBlocks() const                { return blocks.size(); }
+    BasicBlock *Block(int n) const       { return blocks[n]; }
+    BasicBlock *Entry() const            { return blocks[0]; }
+
+          // The reachable blocks, entry first, in reverse postorder
+    const std::vector<BasicBlock*> &ReversePostorder() const { return order; }
+
+          // True if every path from the entry to b goes through a
+          // (a block dominates itself). False if either is unreachable.
+    bool Dominates(BasicBlock *a, BasicBlock *b) const;
+};
+
+#endif
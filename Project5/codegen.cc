@@ -11,19 +11,33 @@
 #include "mips.h"
 #include "ast_decl.h"
 #include "errors.h"
+#include "liveness.h"
+#include "interference.h"
+#include "cfg.h"
+#include "regalloc.h"
+#include "intern.h"
+#include "output.h"
+#include "optimize.h"
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <algorithm>
   
 CodeGenerator::CodeGenerator() {
     code = new List<Instruction*>();
-    label_table = new Hashtable<Instruction*>;
     function_positions = new List<std::pair<int, int> >;
     curGlobalOffset = 0;
+    thisLocation = NULL;
+    numMethodCalls = numDirectMethodCalls = 0;
 }
 
-char *CodeGenerator::NewLabel() {
+const char *CodeGenerator::NewLabel() {
     static int nextLabelNum = 0;
     char temp[10];
     sprintf(temp, "_L%d", nextLabelNum++);
-    return strdup(temp);
+    return Intern(temp);
 }
 
 
@@ -79,9 +93,10 @@ Location *CodeGenerator::GenLoad(Location *ref, int offset) {
     return result;
 }
 
-Location *CodeGenerator::GenThis(Location *ref) {
-    code->Append(new LoadThis(ref));
-    return ref;
+Location *CodeGenerator::GenThis() {
+    Assert(thisLocation != NULL);
+    code->Append(new LoadThis(thisLocation));
+    return thisLocation;
 }
 
 void CodeGenerator::GenStore(Location *dst,Location *src, int offset) {
@@ -104,6 +119,15 @@ void CodeGenerator::GenIfZ(Location *test, const char *label) {
     code->Append(new IfZ(test, label));
 }
 
+void CodeGenerator::GenIfCompare(IfCompare::Condition cond, Location *op1, Location *op2,
+                                 const char *label) {
+    code->Append(new IfCompare(cond, op1, op2, label));
+}
+
+void CodeGenerator::GenIfInBounds(Location *index, Location *count, const char *label) {
+    code->Append(new IfInBounds(index, count, label));
+}
+
 void CodeGenerator::GenGoto(const char *label) {
     code->Append(new Goto(label));
 }
@@ -115,24 +139,43 @@ void CodeGenerator::GenReturn(Location *val) {
 
 BeginFunc *CodeGenerator::GenBeginFunc(FnDecl *fn) {
     BeginFunc *result = new BeginFunc(fn->IsMethodDecl());
+    functionBegin = code->NumElements();
     code->Append(insideFn = result);
     List<VarDecl*> *formals = fn->GetFormals();
-    int start = OffsetToFirstParam;
-    Location *temp = NULL;
-    if (fn->IsMethodDecl()) {
-        // temp = new Location(fpRelative, start, "this");
-
-        start += VarSize;
-    }
-    for (int i = 0; i < formals->NumElements(); i++)
-        formals->Nth(i)->rtLoc = new Location(fpRelative, i*VarSize + start, formals->Nth(i)->GetName());
     curStackOffset = OffsetToFirstLocal;
+    int n = 0; // number of the next parameter, counting "this"
+    thisLocation = fn->IsMethodDecl() ? GenFormal("this", n++) : NULL;
+    for (int i = 0; i < formals->NumElements(); i++)
+        formals->Nth(i)->rtLoc = GenFormal(formals->Nth(i)->GetName(), n++);
+    int onStack = RegisterArgs() ? std::max(n - (int)NumRegParams, 0) : n;
+    result->SetParamBytes(onStack*VarSize);
+    result->SetTopLabel(NewLabel()); // now, as the back end may run on several threads
 
-    GenCallerLoad(NULL, temp);
+    GenCallerLoad(NULL, NULL, true);
+    return result;
+}
+
+/* Method: GenFormal
+ * -----------------
+ * Returns the Location of the nth parameter of the function being
+ * started. Parameters passed on the stack sit above the saved fp, the
+ * first at fp+4. With -regargs the first NumRegParams arrive in $a0-$a3
+ * instead; each is given a local slot like any other variable and bound
+ * to its register, and the entry CallerLoad moves it from there to
+ * wherever it was allocated.
+ */
+Location *CodeGenerator::GenFormal(const char *name, int n) {
+    if (!RegisterArgs())
+        return new Location(fpRelative, OffsetToFirstParam + n*VarSize, name);
+    if (n >= NumRegParams)
+        return new Location(fpRelative, OffsetToFirstParam + (n - NumRegParams)*VarSize, name);
+    Location *result = GenLocalVariable(name);
+    result->SetArgRegister(n);
     return result;
 }
 
 void CodeGenerator::GenEndFunc() {
+    function_positions->Append(std::make_pair(functionBegin, code->NumElements()));
     code->Append(new EndFunc());
     insideFn->SetFrameSize(OffsetToFirstLocal-curStackOffset);
     insideFn = NULL;
@@ -152,8 +195,8 @@ void CodeGenerator::GenCallerSave() {
     code->Append(new CallerSave());
 }
 
-void CodeGenerator::GenCallerLoad(Location *result, Location *t) {
-    code->Append(new CallerLoad(result, t));
+void CodeGenerator::GenCallerLoad(Location *result, Location *t, bool atEntry) {
+    code->Append(new CallerLoad(result, t, atEntry));
 }
 
 Location *CodeGenerator::GenLCall(const char *label, bool fnHasReturnValue) {
@@ -162,14 +205,34 @@ Location *CodeGenerator::GenLCall(const char *label, bool fnHasReturnValue) {
     return result;
 }
 
+/* Method: GenParams
+ * -----------------
+ * Generates the TAC passing the arguments of a call to a Decaf function
+ * or method, rcvr (if not NULL) being the hidden "this" before them, and
+ * returns the number of bytes they take on the stack. Normally they are
+ * all pushed, right to left. With -regargs the first NumRegParams go in
+ * $a0-$a3 instead, after the rest have been pushed.
+ */
+int CodeGenerator::GenParams(Location *rcvr, List<Location*> *args) {
+    List<Location*> params;
+    if (rcvr) params.Append(rcvr);
+    for (int i = 0; i < args->NumElements(); i++)
+        params.Append(args->Nth(i));
+    int numInRegs = RegisterArgs() ? std::min(params.NumElements(), (int)NumRegParams) : 0;
+    for (int i = params.NumElements()-1; i >= numInRegs; i--) // push params right to left
+        GenPushParam(params.Nth(i));
+    for (int i = 0; i < numInRegs; i++)
+        code->Append(new RegParam(params.Nth(i), i));
+    return (params.NumElements() - numInRegs)*VarSize;
+}
+
 Location *CodeGenerator::GenFunctionCall(const char *fnLabel, List<Location*> *args, bool hasReturnValue) {
     GenCallerSave();
 
 
-    for (int i = args->NumElements()-1; i >= 0; i--) // push params right to left
-        GenPushParam(args->Nth(i));
+    int bytes = GenParams(NULL, args);
     Location *result = GenLCall(fnLabel, hasReturnValue);
-    GenPopParams(args->NumElements()*VarSize);
+    GenPopParams(bytes);
 
 
     GenCallerLoad(result);
@@ -186,12 +249,10 @@ Location *CodeGenerator::GenMethodCall(Location *rcvr, Location *meth, List<Loca
     GenCallerSave();
 
 
-    for (int i = args->NumElements()-1; i >= 0; i--)
-        GenPushParam(args->Nth(i));
-    GenPushParam(rcvr);	// hidden "this" parameter
+    int bytes = GenParams(rcvr, args);	// rcvr is the hidden "this" parameter
     
     Location *result= GenACall(meth, fnHasReturnValue);
-    GenPopParams((args->NumElements()+1)*VarSize);
+    GenPopParams(bytes);
 
 
     GenCallerLoad(result);
@@ -241,30 +302,43 @@ void CodeGenerator::GenVTable(const char *className, List<const char *> *methodL
 
 
 void CodeGenerator::DoFinalCodeGen() {
-    LivenessAnalysis();
     if (IsDebugOn("tac")) { // if debug don't translate to mips, just print Tac
         for (int i = 0; i < code->NumElements(); i++)
 	        code->Nth(i)->Print();
     }
     else {
+        if (OptLevel() >= 2)
+            InlineCalls(code, function_positions);
         Mips mips;
-        List<Location*> locations;
-        for (int i = 0; i < code->NumElements(); ++i) {
-            for (int j = 0; j < code->Nth(i)->GetLiveVariables()->NumElements(); ++j)
-                locations.Append(code->Nth(i)->GetLiveVariables()->Nth(j));
-        }
-        locations.Unique();
-        mips.AllocateRegisters(&locations);
         mips.EmitPreamble();
-        for (int i = 0; i < code->NumElements(); i++)
+        std::vector<std::string> functionCode;
+        if (NumJobs() > 1)
+            GenFunctionsInParallel(&functionCode);
+        int next = 0; // next function in function_positions
+        for (int i = 0; i < code->NumElements(); i++) {
+            if (next < function_positions->NumElements() && function_positions->Nth(next).first == i) {
+                if (functionCode.empty())
+                    GenFunctionCode(&mips, i, function_positions->Nth(next).second);
+                else {
+                    AsmOutput()->Append(functionCode[next]);
+                    std::string().swap(functionCode[next]);
+                }
+                i = function_positions->Nth(next++).second;
+            } else
 	        code->Nth(i)->Emit(&mips);
+        }
+        if (IsDebugOn("peephole"))
+            Peephole::PrintStats();
+        if (IsDebugOn("devirt"))
+            fprintf(stderr, "devirt: %d of %d method calls made direct\n",
+                    numDirectMethodCalls, numMethodCalls);
     }
 }
 
 
 
 Location *CodeGenerator::GenArrayLen(Location *array) {
-    return GenLoad(array, -4);
+    return GenLoad(array, OffsetToArrayLength);
 }
 
 Location *CodeGenerator::GenNew(const char *vTableLabel, int instanceSize) {
@@ -280,20 +354,33 @@ Location *CodeGenerator::GenDynamicDispatch(Location *rcvr, int vtableOffset, Li
     Location *vptr = GenLoad(rcvr); // load vptr
     Assert(vtableOffset >= 0);
     Location *m = GenLoad(vptr, vtableOffset*4);
+    numMethodCalls++;
     return GenMethodCall(rcvr, m, args, hasReturnValue);
 }
 
+Location *CodeGenerator::GenDirectMethodCall(Location *rcvr, const char *fnLabel, List<Location*> *args, bool hasReturnValue) {
+    numMethodCalls++;
+    numDirectMethodCalls++;
+    GenCallerSave();
+    int bytes = GenParams(rcvr, args);	// rcvr is the hidden "this" parameter
+    Location *result = GenLCall(fnLabel, hasReturnValue);
+    GenPopParams(bytes);
+    GenCallerLoad(result);
+    return result;
+}
+
 // all variables (ints, bools, ptrs, arrays) are 4 bytes in for code generation
 // so this simplifies the math for offsets
+/* Method: GenSubscript
+ * ---------------------
+ * The bounds check is one branch over the error path, taken when
+ * 0 <= index < count. Compared unsigned, a negative index is larger
+ * than any count, so a single compare covers both ends.
+ */
 Location *CodeGenerator::GenSubscript(Location *array, Location *index) {
-    Location *zero = GenLoadConstant(0);
-    Location *isNegative = GenBinaryOp("<", index, zero);
-    Location *count = GenLoad(array, -4);
-    Location *isWithinRange = GenBinaryOp("<", index, count);
-    Location *pastEnd = GenBinaryOp("==", isWithinRange, zero);
-    Location *outOfRange = GenBinaryOp("||", isNegative, pastEnd);
+    Location *count = GenArrayLen(array);
     const char *pastError = NewLabel();
-    GenIfZ(outOfRange, pastError);
+    GenIfInBounds(index, count, pastError);
     GenHaltWithMessage(err_arr_out_of_bounds);
     GenLabel(pastError);
     Location *four = GenLoadConstant(VarSize);
@@ -328,180 +415,217 @@ void CodeGenerator::GenHaltWithMessage(const char *message) {
     GenBuiltInCall(Halt, NULL);
 }
 
-void CodeGenerator::ConstructCFG() {
-    for (int i = 0; i < code-> NumElements(); i++) {
-        if (dynamic_cast<Label*> (code-> Nth(i)) && i != code-> NumElements() - 1) {
-            Label *label = dynamic_cast<Label*> (code-> Nth(i));
-            label_table-> Enter(label-> GetLabel(), code-> Nth(i + 1));
+/* Method: VarLiveAnalysis
+ * -----------------------
+ * Records in table the variables live just before or just after each
+ * TAC of the function (the union of its IN and OUT), listed in the
+ * order the liveness analysis numbered them. The caller-save code saves
+ * and restores exactly these around calls, so the CallerSave and
+ * CallerLoad TACs get their own copy to emit from.
+ */
+void CodeGenerator::VarLiveAnalysis(FlowGraph *graph, Liveness *liveness, LiveAtTac *table) {
+    BitVector live(liveness-> NumVars()), in_or_out(liveness-> NumVars());
+    for (int b = 0, n = 0; b < graph-> NumBlocks(); b++) {
+        List<Instruction*> *tacs = &graph-> Block(b)-> code;
+        live = liveness-> LiveOut(graph-> Block(b));
+        n += tacs-> NumElements();
+        for (int i = tacs-> NumElements() - 1; i >= 0; i--) {
+            Instruction *tac = tacs-> Nth(i);
+            in_or_out = live;
+            liveness-> StepBack(tac, &live);
+            in_or_out.UnionWith(live);
+            int pos = n - tacs-> NumElements() + i;
+            table-> Record(pos, in_or_out, *liveness);
+            if (CallBoundary *boundary = dynamic_cast<CallBoundary*> (tac)) {
+                List<Location*> *liveVariables = boundary-> GetLiveVariables();
+                liveVariables-> Clear();
+                for (int j = 0; j < table-> NumLive(pos); j++)
+                    liveVariables-> Append(table-> Live(pos, j));
+            }
         }
     }
-    // bool isInFunction = false;
-    int function_begin = -1;
-    for (int i = 0; i < code-> NumElements(); i++) {
-        // if (isInFunction) {
-            if (dynamic_cast<EndFunc*> (code-> Nth(i)) || dynamic_cast<Return*> (code-> Nth(i))) {
-                // isInFunction = false;
-                // function_positions-> Append(std::make_pair(function_begin, i));
-            } else if (dynamic_cast<Goto*> (code-> Nth(i))) {
-                Goto *gt = dynamic_cast<Goto*> (code-> Nth(i));
-                Instruction *goto_tac = label_table-> Lookup(gt-> GetLabel());
-                code-> Nth(i)-> successors.Append(goto_tac);
-            } else if (dynamic_cast<IfZ*> (code-> Nth(i))) {
-                IfZ *ifz = dynamic_cast<IfZ*> (code-> Nth(i));
-                Instruction *ifz_tac = label_table-> Lookup(ifz-> GetLabel());
-                code-> Nth(i)-> successors.Append(ifz_tac);
-                if (i != code-> NumElements() - 1)
-                    code-> Nth(i)-> successors.Append(code-> Nth(i + 1));  // need to consider???
-            } else {
-                Instruction *inst = code-> Nth(i);
-                if (i != code-> NumElements() - 1)
-                    code-> Nth(i)-> successors.Append(code-> Nth(i + 1));
+}
+
+// How many times a call in the block is guessed to run per invocation,
+// for deciding what belongs in callee-saved registers
+static int CallWeight(BasicBlock *block) {
+    return block-> loopDepth > 0 ? 10 : 1;
+}
+
+/* Method: ConstructRIG
+ * --------------------
+ * Builds the register interference graph of the function. A variable
+ * written by a TAC interferes with everything live just after it,
+ * except that the destination of a copy does not interfere with its
+ * source (they hold the same value, so the copy is a candidate for
+ * coalescing and is recorded as a move). Variables live on entry to the
+ * function all interfere with each other. Variables live after a call
+ * (other than its result) are counted as crossing it. Globals are left out; they
+ * are shared by every function and so always live in memory rather
+ * than in a register. The caller owns (and should delete) the returned
+ * graph.
+ */
+InterferenceGraph *CodeGenerator::ConstructRIG(FlowGraph *graph, Liveness *liveness,
+                                               const LiveAtTac &table, int numTacs) {
+    std::vector<Location*> vars;
+    std::vector<int> node_of(liveness-> NumVars(), -1); // node of each live variable
+    for (int n = 0; n < numTacs; n++) {
+        for (int j = 0; j < table.NumLive(n); j++) {
+            Location *var = table.Live(n, j);
+            int v = liveness-> IndexOf(var);
+            if (var-> GetSegment() == fpRelative && node_of[v] == -1) {
+                node_of[v] = vars.size();
+                vars.push_back(var);
             }
-        // }
-        // else if (dynamic_cast<BeginFunc*> (code-> Nth(i))) {
-        //     isInFunction = true;
-        //     function_begin = i;
-        //     BeginFunc *bgfn = dynamic_cast<BeginFunc*> (code-> Nth(i));
-        //     bgfn-> successors.Append(code-> Nth(i + 1));
-        // }
+        }
     }
-}
 
-void CodeGenerator::VarLiveAnalysis() {
-    // for (int p = 0; p < function_positions-> NumElements(); p++) {  // loop over functions one by one
-        bool changed = true;
-        while (changed) {
-            changed = false;
-            for (int i = code-> NumElements() - 1; i >= 0; i--) {  // for each TAC in CFG
-                Instruction *curr_tac = code-> Nth(i);
-                // OUT[TAC] = Union(IN[SUCC(TAC)])
-                for (int j = 0; j < curr_tac-> successors.NumElements(); j++) {
-                    curr_tac-> out_set.insert(curr_tac-> successors.Nth(j)-> in_set.begin(), curr_tac-> successors.Nth(j)-> in_set.end());
-                }
-                // IN'[TAC] = OUT[TAC] - KILL(TAC) + GEN(TAC)
-                curr_tac-> SetKill();
-                if (dynamic_cast<BeginFunc *>(curr_tac)) {
-                    curr_tac-> SetGen();
-                } else {
-                    curr_tac-> SetGen();
-                }
-                curr_tac-> intemp_set = curr_tac-> out_set;
-                for (auto kill_item : curr_tac-> kill_set) {
-                    curr_tac-> intemp_set.erase(kill_item);
-                }
-                curr_tac-> intemp_set.insert(curr_tac-> gen_set.begin(), curr_tac-> gen_set.end());
-                // if IN'[TAC] != IN[TAC]
-                if (curr_tac-> intemp_set != curr_tac-> in_set) {
-                    curr_tac-> in_set = curr_tac-> intemp_set;
-                    changed = true;
-                }
+    InterferenceGraph *rig = new InterferenceGraph(vars);
+    BitVector live(liveness-> NumVars()), clique(vars.size());
+    for (int b = 0; b < graph-> NumBlocks(); b++) {
+        List<Instruction*> *tacs = &graph-> Block(b)-> code;
+        live = liveness-> LiveOut(graph-> Block(b));
+        for (int i = tacs-> NumElements() - 1; i >= 0; i--) {
+            Instruction *tac = tacs-> Nth(i);
+            Location *gen[Instruction::MaxGen], *kill = tac-> GetKill();
+            int numGen = tac-> GetGen(gen);
+            int dst = kill ? node_of[liveness-> IndexOf(kill)] : -1, src = -1;
+            if (dynamic_cast<Assign*> (tac))
+                src = node_of[liveness-> IndexOf(gen[0])];
+            if (dynamic_cast<LCall*> (tac) || dynamic_cast<ACall*> (tac)) {
+                for (int v = live.NextSetBit(0); v != -1; v = live.NextSetBit(v + 1))
+                    if (node_of[v] != -1 && node_of[v] != dst)
+                        rig-> AddCallCrossed(node_of[v], CallWeight(graph-> Block(b)));
             }
+            if (dst != -1) {
+                rig-> AddUse(dst);
+                for (int v = live.NextSetBit(0); v != -1; v = live.NextSetBit(v + 1))
+                    if (node_of[v] != -1 && node_of[v] != src)
+                        rig-> AddEdge(dst, node_of[v]);
+                if (src != -1 && src != dst)
+                    rig-> AddMove(dst, src);
+            }
+            for (int j = 0; j < numGen; j++)
+                if (node_of[liveness-> IndexOf(gen[j])] != -1)
+                    rig-> AddUse(node_of[liveness-> IndexOf(gen[j])]);
+            liveness-> StepBack(tac, &live);
         }
-        for (int i = code-> NumElements() - 1; i >= 0; i--) {
-            code-> Nth(i)-> in_set.insert(code-> Nth(i)-> out_set.begin(), code-> Nth(i)-> out_set.end());
-            code-> Nth(i)-> liveVariables.Clear();
-            for (auto it : code-> Nth(i)-> in_set) {
-                code-> Nth(i)-> liveVariables.Append(it);
+    }
+    const BitVector &entry = liveness-> LiveIn(graph-> Entry());
+    for (int v = entry.NextSetBit(0); v != -1; v = entry.NextSetBit(v + 1))
+        if (node_of[v] != -1) clique.Set(node_of[v]);
+    rig-> AddClique(clique);
+    rig-> Finish();
+    return rig;
+}
+
+/* Method: ComputeLiveIntervals
+ * ----------------------------
+ * Numbers the TACs of the function in layout order and gives each local
+ * variable the interval from the first to the last TAC at which it is
+ * live or written. Writes count because a register written by a dead
+ * store must not belong to anything else at that point. Variables live
+ * at a call, other than its result, are counted as crossing it. Used in place
+ * of the interference graph by the -O1 linear scan allocator.
+ */
+void CodeGenerator::ComputeLiveIntervals(FlowGraph *graph, Liveness *liveness,
+                                         const LiveAtTac &table,
+                                         std::vector<LiveInterval> *intervals) {
+    std::vector<int> interval_of(liveness-> NumVars(), -1);
+    int pos = 0;
+    for (int b = 0; b < graph-> NumBlocks(); b++) {
+        List<Instruction*> *tacs = &graph-> Block(b)-> code;
+        for (int i = 0; i < tacs-> NumElements(); i++, pos++) {
+            Instruction *tac = tacs-> Nth(i);
+            bool isCall = dynamic_cast<LCall*> (tac) || dynamic_cast<ACall*> (tac);
+            for (int j = -1; j < table.NumLive(pos); j++) {
+                Location *var = (j == -1) ? tac-> GetKill() : table.Live(pos, j);
+                if (var == NULL || var-> GetSegment() != fpRelative)
+                    continue;
+                int &n = interval_of[liveness-> IndexOf(var)];
+                if (n == -1) {
+                    n = intervals-> size();
+                    LiveInterval fresh = {var, pos, pos, 0, -1};
+                    intervals-> push_back(fresh);
+                }
+                (*intervals)[n].end = pos;
+                if (isCall && var != tac-> GetKill())
+                    (*intervals)[n].callsCrossed += CallWeight(graph-> Block(b));
             }
-            code-> Nth(i)-> liveVariables.Unique();
         }
-    //  }
+    }
 }
 
-void CodeGenerator::ConstructRIG() {
-    // for (int p = 0; p < function_positions-> NumElements(); p++) {
-        // BeginFunc* bgfn = dynamic_cast<BeginFunc*> (code-> Nth(function_positions-> Nth(p).first));
-        for (int i = 0; i < code-> NumElements(); i++) {
-            Instruction *curr_tac = code-> Nth(i);
-            for (auto in_item_src : curr_tac-> in_set) {
-                if (inter_graph.find(in_item_src) == inter_graph.end()) {
-                    inter_graph[in_item_src] = {};
-                }
-                for (auto in_item_dst : curr_tac-> in_set) {
-                    if (in_item_src != in_item_dst) {
-                        inter_graph[in_item_src].insert(in_item_dst);
-                        in_item_src-> AddInterference(in_item_dst);  // use the provided method again
-                    }
-                }
-            }
-            // // Do the same thing for the union of out_set and kill_set, but don't know why ???
-            // for (auto kill_item_src : curr_tac-> kill_set) {
-            //     if (bgfn-> inter_graph.find(kill_item_src) == bgfn-> inter_graph.end()) {
-            //         bgfn-> inter_graph[kill_item_src] = {};
-            //     }
-            //     for (auto kill_item_dst : curr_tac-> kill_set) {
-            //         if (kill_item_src != kill_item_dst) {
-            //             bgfn-> inter_graph[kill_item_src].insert(kill_item_dst);
-            //             kill_item_src-> AddInterference(kill_item_dst);  // use the provided method again
-            //         }
-            //     }
-            //     for (auto out_item_dst : curr_tac-> out_set) {
-            //         if (kill_item_src != out_item_dst) {
-            //             bgfn-> inter_graph[kill_item_src].insert(out_item_dst);
-            //             kill_item_src-> AddInterference(out_item_dst);  // use the provided method again
-            //         }
-            //     }
-            // }
-            // // Do the same thing for the union of out_set and kill_set, but don't know why ???
-            // for (auto out_item_src : curr_tac-> out_set) {
-            //     if (bgfn-> inter_graph.find(out_item_src) == bgfn-> inter_graph.end()) {
-            //         bgfn-> inter_graph[out_item_src] = {};
-            //     }
-            //     for (auto kill_item_dst : curr_tac-> kill_set) {
-            //         if (out_item_src != kill_item_dst) {
-            //             bgfn-> inter_graph[out_item_src].insert(kill_item_dst);
-            //             out_item_src-> AddInterference(kill_item_dst);  // use the provided method again
-            //         }
-            //     }
-            //     for (auto out_item_dst : curr_tac-> out_set) {
-            //         if (out_item_src != out_item_dst) {
-            //             bgfn-> inter_graph[out_item_src].insert(out_item_dst);
-            //             out_item_src-> AddInterference(out_item_dst);  // use the provided method again
-            //         }
-            //     }
-            // }
+/* Method: GenFunctionCode
+ * -----------------------
+ * Runs the back end over one function, code[begin..end] (BeginFunc to
+ * EndFunc): turns its tail calls into jumps, optimizes its TAC at -O2,
+ * divides it into basic blocks, computes liveness, allocates registers
+ * (by coloring its interference graph, or at -O1 by linear scan over
+ * its live intervals) and emits its MIPS block by block. The passes
+ * before allocation work on a copy of the function's TAC, since -j
+ * workers share the code list. The analysis results are dropped
+ * afterwards, so the memory used is bounded by the largest function
+ * rather than the whole program.
+ */
+void CodeGenerator::GenFunctionCode(Mips *mips, int begin, int end) {
+    List<Instruction*> fn;
+    for (int i = begin; i <= end; i++)
+        fn.Append(code-> Nth(i));
+    Label *name = dynamic_cast<Label*> (code-> Nth(begin - 1));
+    EliminateTailCalls(&fn, name-> GetLabel());
+    if (OptLevel() >= 2)
+        OptimizeFunction(&fn);
+    FlowGraph graph(&fn, 0, fn.NumElements() - 1);
+    Liveness liveness(&graph);
+    int numTacs = 0;
+    for (int b = 0; b < graph.NumBlocks(); b++)
+        numTacs += graph.Block(b)-> code.NumElements();
+    LiveAtTac live(numTacs);
+    VarLiveAnalysis(&graph, &liveness, &live);
+    if (OptLevel() >= 2) {
+        InterferenceGraph *rig = ConstructRIG(&graph, &liveness, live, numTacs);
+        mips-> AllocateRegisters(rig);
+        delete rig;
+    } else {
+        std::vector<LiveInterval> intervals;
+        ComputeLiveIntervals(&graph, &liveness, live, &intervals);
+        mips-> AllocateRegisters(&intervals);
+    }
+    for (int b = 0; b < graph.NumBlocks(); b++) {
+        List<Instruction*> *tacs = &graph.Block(b)-> code;
+        for (int i = 0; i < tacs-> NumElements(); i++) {
+            tacs-> Nth(i)-> Emit(mips);
+            if (CallBoundary *boundary = dynamic_cast<CallBoundary*> (tacs-> Nth(i)))
+                boundary-> GetLiveVariables()-> Clear();
         }
-    // }
-}
-
-// void CodeGenerator::ColorGraph() {
-//     int k = 10000;  // Mips::Register::NumRegs;  // try
-//     for (int p = 0; p < function_positions-> NumElements(); p++) {
-//         std::stack<Location*> nodes_removed;
-//         BeginFunc* bgfn = dynamic_cast<BeginFunc*> (code-> Nth(function_positions-> Nth(p).first));
-//         // 1. Remove the nodes
-//         while (bgfn-> inter_graph.size() > 0) {
-//             Location *node_to_remove = NULL;
-//             int max_edges = -1;
-//             for (auto node : bgfn-> inter_graph) {
-//                 if (node.second.size() < k) {
-//                     node_to_remove = node.first;
-//                     break;
-//                 }
-//                 if (node.second.size() > max_edges) {
-//                     node_to_remove = node.first;
-//                     max_edges = node.second.size();
-//                 }
-//             }
-//             for (auto node_to : bgfn-> inter_graph[node_to_remove]) {
-//                 bgfn-> inter_graph[node_to].erase(node_to_remove);
-//             }
-//             nodes_removed.push(node_to_remove);
-//             bgfn-> inter_graph.erase(node_to_remove);
-//         }
-//         // Reconstruct the graph
-//         while (!nodes_removed.empty()) {
-//             Location *curr_node = nodes_removed.top();
-//             nodes_removed.pop();
-//             // remaining for registers
-//         }
-//     }
-// }
-
-/*To be implemented.*/
-void CodeGenerator::LivenessAnalysis() {
-    this-> ConstructCFG();
-    this-> VarLiveAnalysis();
-    this-> ConstructRIG();
-    // this-> ColorGraph();
+    }
+}
+
+/* Method: GenFunctionsInParallel
+ * ------------------------------
+ * Runs GenFunctionCode for every function on NumJobs() threads, each
+ * taking the next unclaimed function until none are left. A function's
+ * assembly goes into its own string, indexed like function_positions,
+ * so the caller can print them back in source order. Functions share
+ * nothing the back end writes to except their own TAC, so the threads
+ * need no locking beyond claiming work.
+ */
+void CodeGenerator::GenFunctionsInParallel(std::vector<std::string> *functionCode) {
+    int numFunctions = function_positions-> NumElements();
+    int numThreads = std::min(NumJobs(), numFunctions);
+    functionCode-> assign(numFunctions, std::string());
+    std::vector<Mips> mips(numThreads); // constructed here, Mips() sets shared tables
+    std::vector<std::thread> threads;
+    std::atomic<int> nextFunction(0);
+    for (int t = 0; t < numThreads; t++) {
+        threads.push_back(std::thread([this, t, numFunctions, functionCode, &mips, &nextFunction]() {
+            for (int f; (f = nextFunction++) < numFunctions; ) {
+                mips[t].SetOutput(&(*functionCode)[f]);
+                GenFunctionCode(&mips[t], function_positions-> Nth(f).first, function_positions-> Nth(f).second);
+            }
+        }));
+    }
+    for (int t = 0; t < numThreads; t++)
+        threads[t].join();
 }
@@ -14,26 +14,47 @@
 #include <set>
 #include <map>
 #include <stack>
+#include <vector>
+#include <string>
 #include "list.h"
 #include "hashtable.h"
 #include "tac.h"
 class FnDecl; 
+class Mips;
+class InterferenceGraph;
+class FlowGraph;
+class Liveness;
+class LiveAtTac;
+struct LiveInterval;
 
 // These codes are used to identify the built-in functions
 typedef enum { Alloc, ReadLine, ReadInteger, StringEqual,
                PrintInt, PrintString, PrintBool, Halt, NumBuiltIns } BuiltIn;
 
-typedef std::map<Location*, std::set<Location*> > INTERFERENCEGRAPH;
-
 class CodeGenerator {
   private:
     List<Instruction*> *code;
     int curStackOffset, curGlobalOffset;
     BeginFunc *insideFn;
-    Hashtable<Instruction*> *label_table;  // used to construct the CFG
+    Location *thisLocation;  // of the method being generated
+    int functionBegin;  // position of insideFn in the code list
     List<std::pair<int, int> > *function_positions;  // record the start and end position of functions in the code list
-
-    INTERFERENCEGRAPH inter_graph;
+    int numMethodCalls, numDirectMethodCalls;  // reported with -d devirt
+
+    // Back end for a single function, code[begin..end] from BeginFunc
+    // to EndFunc. Each function is split into basic blocks, analyzed,
+    // allocated and emitted on its own.
+    void VarLiveAnalysis(FlowGraph *graph, Liveness *liveness, LiveAtTac *table);
+    InterferenceGraph *ConstructRIG(FlowGraph *graph, Liveness *liveness,
+                                    const LiveAtTac &table, int numTacs);
+    void ComputeLiveIntervals(FlowGraph *graph, Liveness *liveness,
+                              const LiveAtTac &table,
+                              std::vector<LiveInterval> *intervals);
+    void GenFunctionCode(Mips *mips, int begin, int end);
+    void GenFunctionsInParallel(std::vector<std::string> *functionCode);
+
+    Location *GenFormal(const char *name, int n);
+    int GenParams(Location *rcvr, List<Location*> *args);
 
   public:
     // Here are some class constants to remind you of the offsets
@@ -50,12 +71,16 @@ class CodeGenerator {
                      OffsetToFirstParam = 4,
                      OffsetToFirstGlobal = 0;
     static const int VarSize = 4;
+    // An array's length is kept in the word before its first element
+    static const int OffsetToArrayLength = -4;
+    // Parameters passed in $a0-$a3 with -regargs
+    static const int NumRegParams = 4;
 
     CodeGenerator();
     
     // Assigns a new unique label name and returns it. Does not
     // generate any Tac instructions (see GenLabel below if needed)
-    char *NewLabel();
+    static const char *NewLabel();
 
     // Creates and returns a Location for a new uniquely named
     // temp variable. Does not generate any Tac instructions
@@ -97,7 +122,8 @@ class CodeGenerator {
     // negative number of bytes. If not given, 0 is assumed.
     Location *GenLoad(Location *addr, int offset = 0);
 
-    Location *GenThis(Location *addr);
+    // Returns the Location of "this" in the method being generated
+    Location *GenThis();
 
     
     // Generates Tac instructions to perform one of the binary ops
@@ -120,7 +146,9 @@ class CodeGenerator {
 
     void GenCallerSave();
 
-    void GenCallerLoad(Location *result, Location *t=NULL);
+    // Loads the registers of the variables live after a call (or, with
+    // atEntry, the formals live on entry to the function) from the stack
+    void GenCallerLoad(Location *result, Location *t=NULL, bool atEntry=false);
 
     // Generates the Tac instructions for a LCall, a jump to
     // a compile-time label. The params to the target routine
@@ -155,6 +183,9 @@ class CodeGenerator {
     // (or omit arg) to GenReturn for a return that does not
     // return a value
     void GenIfZ(Location *test, const char *label);
+    void GenIfCompare(IfCompare::Condition cond, Location *op1, Location *op2,
+                      const char *label);
+    void GenIfInBounds(Location *index, Location *count, const char *label);
     void GenGoto(const char *label);
     void GenReturn(Location *val = NULL);
     void GenLabel(const char *label);
@@ -186,16 +217,14 @@ class CodeGenerator {
     Location *GenArrayLen(Location *array);
     Location *GenNew(const char *vTableLabel, int instanceSize);
     Location *GenDynamicDispatch(Location *obj, int vtableOffset, List<Location*> *args, bool hasReturnValue);
+    // A method call known to reach fnLabel whatever the receiver's
+    // class, made with an LCall instead of through the vtable
+    Location *GenDirectMethodCall(Location *obj, const char *fnLabel, List<Location*> *args, bool hasReturnValue);
     Location *GenSubscript(Location *array, Location *index);
     Location *GenFunctionCall(const char *fnLabel, List<Location*> *args, bool hasReturnValue);
     // private helper, not for public user
     Location *GenMethodCall(Location*rcvr, Location*meth, List<Location*> *args, bool hasReturnValue);
     void GenHaltWithMessage(const char *msg);
-    void ConstructCFG();
-    void VarLiveAnalysis();
-    void ConstructRIG();
-    void ColorGraph();
-    void LivenessAnalysis();
 };
 
 #endif
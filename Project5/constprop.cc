@@ -0,0 +1,220 @@
+/* File: constprop.cc
+ * ------------------
+ * Constant folding and propagation over the TAC of one function.
+ */
+
+#include "optimize.h"
+#include "cfg.h"
+#include "reaching.h"
+#include "tac.h"
+#include <limits.h>
+#include <unordered_set>
+#include <unordered_map>
+
+  // The LoadConstants that TACs folded in the current round became,
+  // so that what they define is known to the rest of the round
+typedef std::unordered_map<Instruction*, Instruction*> Folded;
+
+
+/* Function: KnownValue
+ * --------------------
+ * Returns true, with the value in value, if var holds the same constant
+ * whichever of its definitions in reaching it was last written by. The
+ * value on entry (a formal's argument, garbage in a local) is never
+ * known, and neither is a variable that no definition reaches, which
+ * only happens in code that cannot run.
+ */
+static bool KnownValue(Location *var, const ReachingDefs &defs, const BitVector &reaching,
+                       const Folded &folded, int *value)
+{
+    if (var-> GetSegment() != fpRelative) return false;
+    int v = defs.IndexOf(var), end = defs.EndDef(v);
+    if (reaching.Test(defs.FirstDef(v))) return false;
+    bool found = false;
+    for (int d = reaching.NextSetBit(defs.FirstDef(v)); d != -1 && d < end; d = reaching.NextSetBit(d + 1)) {
+        Folded::const_iterator f = folded.find(defs.Def(d));
+        Instruction *def = (f == folded.end()) ? defs.Def(d) : f-> second;
+        LoadConstant *load = dynamic_cast<LoadConstant*> (def);
+        if (!load || (found && load-> GetValue() != *value))
+            return false;
+        *value = load-> GetValue();
+        found = true;
+    }
+    return found;
+}
+
+/* Function: Evaluate
+ * ------------------
+ * Computes a op b the way the MIPS instruction it becomes would, into
+ * result. Returns false for what must be left to run time: add and sub
+ * trap on overflow, and division by zero (or of INT_MIN by -1) is the
+ * simulator's to report.
+ */
+static bool Evaluate(BinaryOp::OpCode code, int a, int b, int *result)
+{
+    long long wide;
+    switch (code) {
+      case BinaryOp::Add:  wide = (long long)a + b; break;
+      case BinaryOp::Sub:  wide = (long long)a - b; break;
+      case BinaryOp::Mul:  *result = (int)((unsigned)a * (unsigned)b); return true;
+      case BinaryOp::Div:
+      case BinaryOp::Mod:
+        if (b == 0 || (a == INT_MIN && b == -1)) return false;
+        *result = (code == BinaryOp::Div) ? a / b : a % b;
+        return true;
+      case BinaryOp::Eq:   *result = (a == b); return true;
+      case BinaryOp::Less: *result = (a < b); return true;
+      case BinaryOp::And:  *result = a & b; return true;
+      case BinaryOp::Or:   *result = a | b; return true;
+      default:             return false;
+    }
+    if (wide < INT_MIN || wide > INT_MAX) return false;
+    *result = (int)wide;
+    return true;
+}
+
+  // Whether a and b compare as cond says
+static bool Holds(IfCompare::Condition cond, int a, int b)
+{
+    switch (cond) {
+      case IfCompare::Eq:      return a == b;
+      case IfCompare::Ne:      return a != b;
+      case IfCompare::Less:    return a < b;
+      case IfCompare::LessEq:  return a <= b;
+      case IfCompare::Greater: return a > b;
+      default:                 return a >= b;
+    }
+}
+
+/* Function: Fold
+ * --------------
+ * Returns what tac becomes given the definitions in reaching: tac
+ * itself if nothing about it is known, NULL if it can go, or the TAC to
+ * put in its place.
+ */
+static Instruction *Fold(Instruction *tac, const ReachingDefs &defs, const BitVector &reaching,
+                         const Folded &folded)
+{
+    Location *gen[Instruction::MaxGen];
+    int a, b;
+    if (dynamic_cast<Assign*> (tac)) {
+        tac-> GetGen(gen);
+        if (KnownValue(gen[0], defs, reaching, folded, &a))
+            return new LoadConstant(tac-> GetKill(), a);
+    } else if (BinaryOp *op = dynamic_cast<BinaryOp*> (tac)) {
+        op-> GetGen(gen);
+        int result;
+        if (KnownValue(gen[0], defs, reaching, folded, &a) && KnownValue(gen[1], defs, reaching, folded, &b) &&
+            Evaluate(op-> GetOpCode(), a, b, &result))
+            return new LoadConstant(op-> GetKill(), result);
+    } else if (IfZ *ifz = dynamic_cast<IfZ*> (tac)) {
+        ifz-> GetGen(gen);
+        if (KnownValue(gen[0], defs, reaching, folded, &a))
+            return (a == 0) ? new Goto(ifz-> GetLabel()) : NULL;
+    } else if (IfCompare *cmp = dynamic_cast<IfCompare*> (tac)) {
+        cmp-> GetGen(gen);
+        if (KnownValue(gen[0], defs, reaching, folded, &a) && KnownValue(gen[1], defs, reaching, folded, &b))
+            return Holds(cmp-> GetCondition(), a, b) ? new Goto(cmp-> GetLabel()) : NULL;
+    }
+    return tac;
+}
+
+/* Function: RemoveUnreadConstants
+ * -------------------------------
+ * Drops the LoadConstants into frame variables that no TAC reads, as
+ * folding leaves most of the ones that fed it.
+ */
+static bool RemoveUnreadConstants(List<Instruction*> *tac)
+{
+    std::unordered_set<Location*> read;
+    for (int i = 0; i < tac-> NumElements(); i++) {
+        Location *gen[Instruction::MaxGen];
+        int numGen = tac-> Nth(i)-> GetGen(gen);
+        for (int j = 0; j < numGen; j++)
+            read.insert(gen[j]);
+    }
+    List<Instruction*> kept;
+    for (int i = 0; i < tac-> NumElements(); i++) {
+        Instruction *instr = tac-> Nth(i);
+        Location *dst = instr-> GetKill();
+        if (!dynamic_cast<LoadConstant*> (instr) || dst-> GetSegment() != fpRelative || read.count(dst))
+            kept.Append(instr);
+    }
+    if (kept.NumElements() == tac-> NumElements()) return false;
+    tac-> Clear();
+    tac-> AppendAll(kept);
+    return true;
+}
+
+/* Function: DeadCodeFeedsLiveCode
+ * --------------------------------
+ * Returns true if a block of graph that cannot be reached writes a
+ * variable that reachable code reads. Only then can cutting that block
+ * off make more values known.
+ */
+static bool DeadCodeFeedsLiveCode(FlowGraph *graph)
+{
+    std::unordered_set<Location*> written;
+    for (int b = 0; b < graph-> NumBlocks(); b++) {
+        BasicBlock *block = graph-> Block(b);
+        for (int i = 0; !block-> IsReachable() && i < block-> code.NumElements(); i++) {
+            if (Location *kill = block-> code.Nth(i)-> GetKill())
+                written.insert(kill);
+        }
+    }
+    for (int b = 0; !written.empty() && b < graph-> NumBlocks(); b++) {
+        BasicBlock *block = graph-> Block(b);
+        for (int i = 0; block-> IsReachable() && i < block-> code.NumElements(); i++) {
+            Location *gen[Instruction::MaxGen];
+            int numGen = block-> code.Nth(i)-> GetGen(gen);
+            for (int j = 0; j < numGen; j++)
+                if (written.count(gen[j])) return true;
+        }
+    }
+    return false;
+}
+
+/* Function: FoldConstants
+ * -----------------------
+ * Each round solves reaching definitions, walks the reachable blocks in
+ * reverse postorder folding what it can and lays the function out
+ * again without the unreachable ones. Walking in reverse postorder
+ * lets a constant found early in the round feed the folds after it, so
+ * another round is only worth its analysis when a folded branch cut off
+ * code holding definitions that kept some value unknown.
+ */
+bool FoldConstants(List<Instruction*> *tac)
+{
+    bool changed = false, again = true;
+    for (int round = 0; again; round++) {
+        FlowGraph graph(tac, 0, tac-> NumElements() - 1);
+        const std::vector<BasicBlock*> &order = graph.ReversePostorder();
+        changed |= (int)order.size() < graph.NumBlocks();
+        if (round > 0 && !DeadCodeFeedsLiveCode(&graph)) {
+            Relayout(&graph, tac);
+            break;
+        }
+        ReachingDefs defs(&graph);
+        Folded folded;
+        again = false;
+        for (int k = 0; k < (int)order.size(); k++) {
+            BasicBlock *block = order[k];
+            BitVector reaching = defs.In(block);
+            List<Instruction*> code;
+            for (int i = 0; i < block-> code.NumElements(); i++) {
+                Instruction *instr = block-> code.Nth(i);
+                Instruction *result = Fold(instr, defs, reaching, folded);
+                if (result) code.Append(result);
+                if (result != instr) folded[instr] = result;
+                if (result != instr && (dynamic_cast<IfZ*> (instr) || dynamic_cast<IfCompare*> (instr)))
+                    again = true;
+                defs.StepForward(instr, &reaching);
+            }
+            block-> code.Clear();
+            block-> code.AppendAll(code);
+        }
+        changed |= !folded.empty();
+        Relayout(&graph, tac);
+    }
+    return RemoveUnreadConstants(tac) || changed;
+}
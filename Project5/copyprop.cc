@@ -0,0 +1,160 @@
+/* File: copyprop.cc
+ * -----------------
+ * Copy propagation over the TAC of one function.
+ */
+
+#include "optimize.h"
+#include "cfg.h"
+#include "dataflow.h"
+#include "tac.h"
+#include <unordered_map>
+#include <vector>
+
+
+/* Class: AvailableCopies
+ * ----------------------
+ * Solves for the copies x = y that certainly still hold at each point:
+ * on every path from the entry the copy was made and neither x nor y
+ * written since. The solver only takes unions, so what it works out is
+ * the opposite, the copies that may not hold, which the entry starts
+ * with all of and a write to either side of a copy adds it back to.
+ *
+ * Only copies between frame variables are tracked, a global being
+ * liable to change under any call.
+ */
+class AvailableCopies {
+  private:
+    std::vector<Assign*> copies;
+    std::vector<Location*> srcs;        // as they were when solved
+    std::unordered_map<Instruction*, int> copyIndex;
+    std::unordered_map<Location*, std::vector<int> > touching, into;
+    BitVector entryIn;
+    Dataflow *solution;
+
+  public:
+    AvailableCopies(FlowGraph *graph);
+    ~AvailableCopies()                  { delete solution; }
+
+          // The copies that may not hold on entry to block
+    const BitVector &NotIn(BasicBlock *block) const;
+
+          // Turns the set that may not hold before tac into the set
+          // after it
+    void StepForward(Instruction *tac, BitVector *notHeld) const;
+
+          // Returns what var was copied from, if some copy into it holds
+          // given notHeld; otherwise NULL
+    Location *SourceOf(Location *var, const BitVector &notHeld) const;
+};
+
+AvailableCopies::AvailableCopies(FlowGraph *graph)
+{
+    for (int b = 0; b < graph-> NumBlocks(); b++) {
+        List<Instruction*> *tacs = &graph-> Block(b)-> code;
+        for (int i = 0; i < tacs-> NumElements(); i++) {
+            Assign *copy = dynamic_cast<Assign*> (tacs-> Nth(i));
+            Location *src, *dst = copy ? copy-> GetKill() : NULL;
+            if (!copy || (copy-> GetGen(&src), src == dst) ||
+                src-> GetSegment() != fpRelative || dst-> GetSegment() != fpRelative)
+                continue;
+            int c = copies.size();
+            copies.push_back(copy);
+            srcs.push_back(src);
+            copyIndex[copy] = c;
+            touching[src].push_back(c);
+            touching[dst].push_back(c);
+            into[dst].push_back(c);
+        }
+    }
+    entryIn.Resize(copies.size());
+    for (int c = 0; c < (int)copies.size(); c++)
+        entryIn.Set(c);
+
+    solution = new Dataflow(graph-> NumBlocks(), copies.size(), Dataflow::Forward);
+    BitVector held(copies.size());
+    for (int b = 0; b < graph-> NumBlocks(); b++) {
+        BasicBlock *block = graph-> Block(b);
+        for (int j = 0; j < block-> succs.NumElements(); j++)
+            solution-> AddEdge(b, block-> succs.Nth(j)-> id);
+        BitVector *blockGen = solution-> Gen(b), *blockKill = solution-> Kill(b);
+        if (block == graph-> Entry())
+            *blockGen = entryIn;
+        held.Clear();
+        for (int i = 0; i < block-> code.NumElements(); i++) {
+            Instruction *instr = block-> code.Nth(i);
+            StepForward(instr, blockGen);
+            if (Location *kill = instr-> GetKill()) {
+                std::unordered_map<Location*, std::vector<int> >::const_iterator found = touching.find(kill);
+                if (found != touching.end())
+                    for (int k = 0; k < (int)found-> second.size(); k++)
+                        held.Reset(found-> second[k]);
+            }
+            std::unordered_map<Instruction*, int>::const_iterator c = copyIndex.find(instr);
+            if (c != copyIndex.end()) held.Set(c-> second);
+        }
+        *blockKill = held;
+    }
+    solution-> Solve();
+}
+
+const BitVector &AvailableCopies::NotIn(BasicBlock *block) const
+{
+    return block-> id == 0 ? entryIn : solution-> In(block-> id);
+}
+
+void AvailableCopies::StepForward(Instruction *tac, BitVector *notHeld) const
+{
+    if (Location *kill = tac-> GetKill()) {
+        std::unordered_map<Location*, std::vector<int> >::const_iterator found = touching.find(kill);
+        if (found != touching.end())
+            for (int k = 0; k < (int)found-> second.size(); k++)
+                notHeld-> Set(found-> second[k]);
+    }
+    std::unordered_map<Instruction*, int>::const_iterator c = copyIndex.find(tac);
+    if (c != copyIndex.end()) notHeld-> Reset(c-> second);
+}
+
+Location *AvailableCopies::SourceOf(Location *var, const BitVector &notHeld) const
+{
+    std::unordered_map<Location*, std::vector<int> >::const_iterator found = into.find(var);
+    if (found == into.end()) return NULL;
+    for (int k = 0; k < (int)found-> second.size(); k++)
+        if (!notHeld.Test(found-> second[k])) return srcs[found-> second[k]];
+    return NULL;
+}
+
+
+/* Function: PropagateCopies
+ * -------------------------
+ * A use of x where the copy x = y holds can read y instead, and y in
+ * turn whatever a copy holding there says it was copied from. Sources
+ * are followed as they were before any rewriting, since that is what
+ * the copies that hold were solved for. The copies themselves are left
+ * for RemoveDeadCode to delete once nothing reads them.
+ */
+bool PropagateCopies(List<Instruction*> *tac)
+{
+    FlowGraph graph(tac, 0, tac-> NumElements() - 1);
+    AvailableCopies available(&graph);
+    bool changed = false;
+    for (int b = 0; b < graph.NumBlocks(); b++) {
+        BasicBlock *block = graph.Block(b);
+        BitVector notHeld = available.NotIn(block);
+        for (int i = 0; i < block-> code.NumElements(); i++) {
+            Instruction *instr = block-> code.Nth(i);
+            Location *gen[Instruction::MaxGen];
+            int numGen = instr-> GetGen(gen);
+            for (int j = 0; j < numGen; j++) {
+                Location *src = gen[j], *next;
+                while ((next = available.SourceOf(src, notHeld)) != NULL)
+                    src = next;
+                if (src != gen[j]) {
+                    instr-> ReplaceGen(gen[j], src);
+                    changed = true;
+                }
+            }
+            available.StepForward(instr, &notHeld);
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,104 @@
+/* File: dataflow.cc
+ * -----------------
+ * Implementation of the iterative bit-vector dataflow solver.
+ */
+
+#include "dataflow.h"
+#include <algorithm>
+
+
+Dataflow::Dataflow(int n, int m, Direction dir) :
+    direction(dir), numNodes(n), numFacts(m),
+    succs(n), preds(n), gen(n, BitVector(m)), kill(n, BitVector(m)),
+    in(n, BitVector(m)), out(n, BitVector(m)) {}
+
+void Dataflow::AddEdge(int from, int to)
+{
+    Assert(from >= 0 && from < numNodes && to >= 0 && to < numNodes);
+    succs[from].push_back(to);
+    preds[to].push_back(from);
+}
+
+
+/* Method: ComputeVisitOrder
+ * -------------------------
+ * Fills order with the nodes in reverse postorder of a depth-first walk
+ * from node 0. Nodes that walk never reaches (dead code) are walked
+ * afterwards so they still get a harmless solution. Backward problems
+ * want the opposite order, so that a node follows its successors.
+ */
+void Dataflow::ComputeVisitOrder(std::vector<int> *order)
+{
+    std::vector<int> postorder;
+    std::vector<char> visited(numNodes, false);
+    std::vector<std::pair<int, int> > stack; // (node, next successor to try)
+    postorder.reserve(numNodes);
+    for (int root = 0; root < numNodes; root++) {
+        if (visited[root]) continue;
+        visited[root] = true;
+        stack.push_back(std::make_pair(root, 0));
+        while (!stack.empty()) {
+            int node = stack.back().first, &next = stack.back().second;
+            if (next < (int)succs[node].size()) {
+                int s = succs[node][next++];
+                if (!visited[s]) {
+                    visited[s] = true;
+                    stack.push_back(std::make_pair(s, 0));
+                }
+            } else {
+                postorder.push_back(node);
+                stack.pop_back();
+            }
+        }
+    }
+    order->assign(postorder.rbegin(), postorder.rend());
+    if (direction == Backward)
+        std::reverse(order->begin(), order->end());
+}
+
+
+/* Method: Solve
+ * -------------
+ * Runs the worklist algorithm to a fixpoint. The worklist is a bit
+ * vector over positions in the visit order, scanned round-robin from
+ * the last position processed, so the pending node visited next is
+ * always the earliest one at or after the current position.
+ */
+void Dataflow::Solve()
+{
+    std::vector<int> order, position(numNodes);
+    ComputeVisitOrder(&order);
+    for (int k = 0; k < numNodes; k++)
+        position[order[k]] = k;
+
+    bool backward = (direction == Backward);
+    BitVector pending(numNodes), result(numFacts);
+    for (int k = 0; k < numNodes; k++)
+        pending.Set(k);
+
+    int cursor = 0;
+    while (true) {
+        int k = pending.NextSetBit(cursor);
+        if (k == -1 && (k = pending.NextSetBit(0)) == -1)
+            break;
+        pending.Reset(k);
+        cursor = k + 1;
+
+        int n = order[k];
+        BitVector &meet = backward ? out[n] : in[n];
+        BitVector &xfer = backward ? in[n] : out[n];
+        const std::vector<int> &upstream = backward ? succs[n] : preds[n];
+        const std::vector<int> &downstream = backward ? preds[n] : succs[n];
+
+        for (int i = 0; i < (int)upstream.size(); i++)
+            meet.UnionWith(backward ? in[upstream[i]] : out[upstream[i]]);
+        result = meet;
+        result.Subtract(kill[n]);
+        result.UnionWith(gen[n]);
+        if (result != xfer) {
+            xfer = result;
+            for (int i = 0; i < (int)downstream.size(); i++)
+                pending.Set(position[downstream[i]]);
+        }
+    }
+}
@@ -0,0 +1,60 @@
+/* File: dataflow.h
+ * ----------------
+ * The Dataflow class is a small iterative solver for the classic
+ * gen/kill bit-vector problems (liveness, reaching definitions, ...).
+ * The client numbers its nodes 0..n-1 (node 0 is the entry), numbers
+ * the facts it is tracking 0..m-1, adds the flow edges, fills in the
+ * gen and kill set of each node and calls Solve. Afterwards In(n) and
+ * Out(n) hold the fixpoint of
+ *
+ *     forward:   In[n]  = Union(Out[p]) over predecessors p
+ *                Out[n] = Gen[n] + (In[n] - Kill[n])
+ *     backward:  Out[n] = Union(In[s]) over successors s
+ *                In[n]  = Gen[n] + (Out[n] - Kill[n])
+ *
+ * Nodes are visited from a worklist ordered by reverse postorder of
+ * the flow graph (postorder for backward problems), so an acyclic
+ * region settles in a single pass and each loop costs only as many
+ * passes as its nesting depth.
+ */
+
+#ifndef _H_dataflow
+#define _H_dataflow
+
+#include <vector>
+#include "bitvector.h"
+
+class Dataflow {
+  public:
+    typedef enum { Forward, Backward } Direction;
+
+  private:
+    Direction direction;
+    int numNodes, numFacts;
+    std::vector<std::vector<int> > succs, preds;
+    std::vector<BitVector> gen, kill, in, out;
+
+    void ComputeVisitOrder(std::vector<int> *order);
+
+  public:
+    Dataflow(int numNodes, int numFacts, Direction dir);
+
+    int NumNodes() const { return numNodes; }
+    int NumFacts() const { return numFacts; }
+
+    void AddEdge(int from, int to);
+    const std::vector<int> &Successors(int n) const { return succs[n]; }
+    const std::vector<int> &Predecessors(int n) const { return preds[n]; }
+
+          // Fill these in before calling Solve
+    BitVector *Gen(int n)  { return &gen[n]; }
+    BitVector *Kill(int n) { return &kill[n]; }
+
+    void Solve();
+
+          // Valid after Solve
+    const BitVector &In(int n) const  { return in[n]; }
+    const BitVector &Out(int n) const { return out[n]; }
+};
+
+#endif
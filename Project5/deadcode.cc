@@ -0,0 +1,74 @@
+/* File: deadcode.cc
+ * -----------------
+ * Dead code elimination over the TAC of one function.
+ */
+
+#include "optimize.h"
+#include "cfg.h"
+#include "liveness.h"
+#include "tac.h"
+
+
+/* Function: IsPure
+ * ----------------
+ * Returns true if writing its kill is all tac does, so that it can go
+ * when nothing reads that. Calls and stores have other effects, div
+ * and rem are kept for the error a zero divisor raises, and add and
+ * sub for the trap on overflow, which constant folding keeps as well.
+ */
+static bool IsPure(Instruction *tac)
+{
+    if (BinaryOp *op = dynamic_cast<BinaryOp*> (tac)) {
+        BinaryOp::OpCode code = op-> GetOpCode();
+        return code != BinaryOp::Div && code != BinaryOp::Mod &&
+               code != BinaryOp::Add && code != BinaryOp::Sub;
+    }
+    return dynamic_cast<LoadConstant*> (tac) || dynamic_cast<LoadStringConstant*> (tac) ||
+           dynamic_cast<LoadLabel*> (tac) || dynamic_cast<Assign*> (tac) || dynamic_cast<Load*> (tac);
+}
+
+/* Function: RemoveDeadCode
+ * ------------------------
+ * Walks each block backwards from its live-out set, dropping the pure
+ * TACs whose kill is a frame variable that is dead after them, and
+ * copies of a variable to itself. A dropped TAC's operands are not
+ * made live, so a chain of dead computations inside a block goes in
+ * one walk. When that leaves less live on entry to some block than
+ * liveness said, a computation in another block may have lost its
+ * last reader, so liveness is solved again and the walk repeated
+ * until it settles.
+ */
+bool RemoveDeadCode(List<Instruction*> *tac)
+{
+    bool changed = false, again = true;
+    while (again) {
+        again = false;
+        FlowGraph graph(tac, 0, tac-> NumElements() - 1);
+        Liveness liveness(&graph);
+        for (int b = 0; b < graph.NumBlocks(); b++) {
+            BasicBlock *block = graph.Block(b);
+            BitVector live = liveness.LiveOut(block);
+            List<Instruction*> kept;
+            for (int i = block-> code.NumElements() - 1; i >= 0; i--) {
+                Instruction *instr = block-> code.Nth(i);
+                Location *kill = instr-> GetKill(), *src;
+                if (kill && kill-> GetSegment() == fpRelative && IsPure(instr)) {
+                    bool selfCopy = dynamic_cast<Assign*> (instr) && (instr-> GetGen(&src), src == kill);
+                    if (selfCopy || !live.Test(liveness.IndexOf(kill))) {
+                        changed = true;
+                        continue;
+                    }
+                }
+                liveness.StepBack(instr, &live);
+                kept.Append(instr);
+            }
+            if (kept.NumElements() == block-> code.NumElements()) continue;
+            again |= (live != liveness.LiveIn(block));
+            block-> code.Clear();
+            for (int i = kept.NumElements() - 1; i >= 0; i--)
+                block-> code.Append(kept.Nth(i));
+        }
+        Relayout(&graph, tac);
+    }
+    return changed;
+}
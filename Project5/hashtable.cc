@@ -2,24 +2,79 @@
  * ------------------
  * Implementation of Hashtable class.
  */
-   
+
+#include <algorithm>
+
+
+/* Hashtable::FindSlot
+ * -------------------
+ * Returns the slot holding the given key ID, or the empty slot where it
+ * would go. Slots are probed linearly from the key's hash. Consecutive
+ * IDs (the common case, names being interned as they are scanned) land
+ * in different slots, since multiplying by an odd constant permutes the
+ * low bits.
+ */
+template <class Value> int Hashtable<Value>::FindSlot(int key) const
+{
+  int mask = slotKey.size() - 1;
+  int i = (key * 2654435769u) & mask;
+  while (slotKey[i] != key && slotKey[i] != -1)
+    i = (i + 1) & mask;
+  return i;
+}
+
+/* Hashtable::Grow
+ * ---------------
+ * Doubles the number of slots (starting at 8) and puts the keys back.
+ * Keys whose entries have all been removed are dropped here.
+ */
+template <class Value> void Hashtable<Value>::Grow()
+{
+  std::vector<int> oldKey, oldHead;
+  oldKey.swap(slotKey);
+  oldHead.swap(slotHead);
+  int size = oldKey.empty() ? 8 : 2 * oldKey.size();
+  slotKey.assign(size, -1);
+  slotHead.assign(size, -1);
+  numKeys = 0;
+  for (int i = 0; i < (int)oldKey.size(); i++) {
+    if (oldHead[i] == -1) continue;
+    int j = FindSlot(oldKey[i]);
+    slotKey[j] = oldKey[i];
+    slotHead[j] = oldHead[i];
+    numKeys++;
+  }
+}
+
 
 /* Hashtable::Enter
  * ----------------
  * Stores new value for given identifier. If the key already
- * has an entry and flag is to overwrite, will remove previous entry first,
- * otherwise it just adds another entry under same key. Copies the
- * key, so you don't have to worry about its allocation.
+ * has an entry and flag is to overwrite, the newest entry takes the
+ * new value, otherwise another entry is chained in front of it. The key
+ * is the table's copy from Intern(), so there is nothing to allocate.
  */
 template <class Value> void Hashtable<Value>::Enter(const char *key, Value val, bool overwrite)
 {
-  Value prev;
-  if (overwrite && (prev = Lookup(key)))
-    Remove(key, prev);
-  mmap.insert(std::make_pair(strdup(key), val));
+  int id = InternedId(key);
+  if (2 * (numKeys + 1) > (int)slotKey.size())
+    Grow();
+  int i = FindSlot(id);
+  if (slotKey[i] == -1) {
+    slotKey[i] = id;
+    numKeys++;
+  }
+  if (overwrite && slotHead[i] != -1) {
+    entries[slotHead[i]].value = val;
+    return;
+  }
+  Entry entry = {id, val, slotHead[i]};
+  slotHead[i] = entries.size();
+  entries.push_back(entry);
+  numEntries++;
 }
 
- 
+
 /* Hashtable::Remove
  * -----------------
  * Removes a given key-value pair from table. If no such pair, no
@@ -27,19 +82,21 @@ template <class Value> void Hashtable<Value>::Enter(const char *key, Value val,
  */
 template <class Value> void Hashtable<Value>::Remove(const char *key, Value val)
 {
-  if (mmap.count(key) == 0) // no matches at all
+  if (slotKey.empty()) // no matches at all
     return;
 
-  typename std::multimap<const char *, Value>::iterator itr;
-  itr = mmap.find(key); // start at first occurrence
-  while (itr != mmap.upper_bound(key)) {
-    if (itr->second == val) { // iterate to find matching pair
-	mmap.erase(itr);
-	break;
+  int *link = &slotHead[FindSlot(InternedId(key))];
+  while (*link != -1) {
+    Entry &entry = entries[*link];
+    if (entry.value == val) { // follow the chain to find matching pair
+      entry.key = -1;
+      *link = entry.shadowed;
+      numEntries--;
+      break;
     }
-    ++itr;
+    link = &entry.shadowed;
   }
-} 
+}
 
 
 /* Hashtable::Lookup
@@ -47,23 +104,12 @@ template <class Value> void Hashtable<Value>::Remove(const char *key, Value val)
  * Returns the value earlier stored under key or NULL
  *if there is no matching entry
  */
-template <class Value> Value Hashtable<Value>::Lookup(const char *key) 
+template <class Value> Value Hashtable<Value>::Lookup(const char *key)
 {
-  Value found = NULL;
-  
-  if (mmap.count(key) > 0) {
-    typename std::multimap<const char *, Value>::iterator cur, last, prev;
-    cur = mmap.find(key); // start at first occurrence
-    last = mmap.upper_bound(key);
-    while (cur != last) { // iterate to find last entered
-	prev = cur; 
-	if (++cur == mmap.upper_bound(key)) { // have to go one too far
-	  found = prev->second; // one before last was it
-	  break;
-	}
-    }
-  }
-  return found;
+  if (slotKey.empty())
+    return NULL;
+  int head = slotHead[FindSlot(InternedId(key))];
+  return head == -1 ? NULL : entries[head].value;
 }
 
 
@@ -72,7 +118,7 @@ template <class Value> Value Hashtable<Value>::Lookup(const char *key)
  */
 template <class Value> int Hashtable<Value>::NumEntries() const
 {
-  return mmap.size();
+  return numEntries;
 }
 
 
@@ -80,10 +126,29 @@ template <class Value> int Hashtable<Value>::NumEntries() const
 /* Hashtable:GetIterator
  * ---------------------
  * Returns iterator which can be used to walk through all values in table.
+ * The values are sorted by key, ties broken by the order they were
+ * entered in, which matches the order of the multimap this table
+ * replaced.
  */
-template <class Value> Iterator<Value> Hashtable<Value>::GetIterator() 
+template <class Value> Iterator<Value> Hashtable<Value>::GetIterator()
 {
-  return Iterator<Value>(mmap);
+  std::vector<std::pair<const char*, int> > order; // (key, entry)
+  for (int i = 0; i < (int)entries.size(); i++)
+    if (entries[i].key != -1)
+      order.push_back(std::make_pair(InternedString(entries[i].key), i));
+  struct {
+    bool operator()(const std::pair<const char*, int> &a,
+                    const std::pair<const char*, int> &b) const {
+      int cmp = strcmp(a.first, b.first);
+      return cmp < 0 || (cmp == 0 && a.second < b.second);
+    }
+  } keyThenAge;
+  std::sort(order.begin(), order.end(), keyThenAge);
+
+  Iterator<Value> iter;
+  for (int i = 0; i < (int)order.size(); i++)
+    iter.values.push_back(entries[order[i].second].value);
+  return iter;
 }
 
 
@@ -94,6 +159,5 @@ template <class Value> Iterator<Value> Hashtable<Value>::GetIterator()
  */
 template <class Value> Value Iterator<Value>::GetNextValue()
 {
-  return (cur == end ? NULL : (*cur++).second);
+  return (cur == (int)values.size() ? NULL : values[cur++]);
 }
-
@@ -1,10 +1,12 @@
 /* File: hashtable.h
  * -----------------
  * This is a simple table for storing values associated with a string
- * key, supporting simple operations for Enter and Lookup.  It is not
- * much more than a thin cover over the STL associative map container,
- * but hides the awkward C++ template syntax and provides a more
- * familiar interface.
+ * key, supporting simple operations for Enter and Lookup. Keys must be
+ * interned strings (see intern.h), as identifiers and labels are, and
+ * the table is an open addressing hash table over their IDs, so a
+ * lookup never looks at the key's characters. Values entered under the
+ * same key are chained from newest to oldest, which is what shadowing
+ * needs.
  *
  * The keys are always strings, but the values can be of any type
  * (ok, that's actually kind of a fib, it expects the type to be
@@ -18,7 +20,10 @@
  *
  * An iterator is provided for iterating over the entries in a table. 
  * The iterator walks through the values, one by one, in alphabetical
- * order by the key. Sample iteration usage:
+ * order by the key (values under the same key in the order they were
+ * entered). Scope::CopyFromScope depends on this order, since it
+ * decides the layout of inherited fields. Getting an iterator sorts a
+ * snapshot of the table, so it costs O(n log n). Sample iteration usage:
  *
  *       void PrintNames(Hashtable<Decl*> *table)
  *       {
@@ -33,13 +38,9 @@
 #ifndef _H_hashtable
 #define _H_hashtable
 
-#include <map>
+#include <vector>
 #include <string.h>
-
-struct ltstr {
-  bool operator()(const char* s1, const char* s2) const
-  { return strcmp(s1, s2) < 0; }
-};
+#include "intern.h"
 
 
 template <class Value> class Iterator;
@@ -47,11 +48,22 @@ template <class Value> class Iterator;
 template<class Value> class Hashtable {
 
   private: 
-     std::multimap<const char*, Value, ltstr> mmap;
+     struct Entry {
+         int key;        // interned ID, -1 once removed
+         Value value;
+         int shadowed;   // entry this one shadows, -1 if none
+     };
+     std::vector<Entry> entries;   // in the order entered
+     std::vector<int> slotKey;     // key ID in each slot, -1 for empty
+     std::vector<int> slotHead;    // newest entry for that key, -1 if none left
+     int numKeys, numEntries;
+
+     int FindSlot(int key) const;
+     void Grow();
  
    public:
             // ctor creates a new empty hashtable
-     Hashtable() {}
+     Hashtable() : numKeys(0), numEntries(0) {}
 
            // Returns number of entries currently in table
      int NumEntries() const;
@@ -91,9 +103,9 @@ template<class Value> class Iterator {
   friend class Hashtable<Value>;
 
   private:
-    typename std::multimap<const char*, Value , ltstr>::iterator cur, end;
-    Iterator(std::multimap<const char*, Value, ltstr>& t)
-      : cur(t.begin()), end(t.end()) {}
+    std::vector<Value> values;  // sorted snapshot of the table
+    int cur;
+    Iterator() : cur(0) {}
 
   public:
          // Returns current value and advances iterator to next.
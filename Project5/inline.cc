@@ -0,0 +1,229 @@
+/* File: inline.cc
+ * ---------------
+ * Inlining of small Decaf functions and methods at their call sites.
+ */
+
+#include "optimize.h"
+#include "callsite.h"
+#include "codegen.h"
+#include "tac.h"
+#include "utility.h"
+#include <stdio.h>
+#include <unordered_map>
+#include <vector>
+
+  // Largest body, in TACs, copied to a call site, and to one inside a
+  // loop, where the call would be paid for on every trip
+static const int MaxInlineSize = 12, MaxInlineSizeInLoop = 30;
+  // No more is inlined into a function once it has grown this big
+static const int MaxCallerSize = 2000;
+  // A function whose calls have all been inlined can be inlined itself
+  // in the next round
+static const int MaxRounds = 3;
+
+
+  // A function as the inliner sees it
+struct Function {
+    List<Instruction*> code;            // BeginFunc to EndFunc
+    bool leaf;                          // calls nothing but built-ins
+    std::vector<Location*> formals;     // those its code uses
+};
+
+
+/* Class: FrameRenaming
+ * --------------------
+ * Gives each frame variable of the function being inlined a new slot of
+ * its own at the bottom of the caller's frame, and each of its labels a
+ * new name. Globals stay as they are.
+ */
+class FrameRenaming: public Renaming {
+  private:
+    BeginFunc *frame;
+    std::unordered_map<Location*, Location*> vars;
+    std::unordered_map<const char*, const char*> labels;
+
+  public:
+    FrameRenaming(BeginFunc *callerFrame) : frame(callerFrame) {}
+
+    Location *RenameVar(Location *var) {
+        if (!var || var-> GetSegment() != fpRelative) return var;
+        Location *&copy = vars[var];
+        if (!copy) copy = NewFrameVariable(frame, var-> GetName());
+        return copy;
+    }
+    const char *RenameLabel(const char *label) {
+        const char *&copy = labels[label];
+        if (!copy) copy = CodeGenerator::NewLabel();
+        return copy;
+    }
+};
+
+
+/* Function: Summarize
+ * -------------------
+ * Works out whether fn is a leaf and which formals it uses.
+ */
+static void Summarize(Function *fn, const std::unordered_map<const char*, int> &byLabel)
+{
+    fn-> leaf = true;
+    for (int i = 0; i < fn-> code.NumElements() && fn-> leaf; i++) {
+        LCall *call = dynamic_cast<LCall*> (fn-> code.Nth(i));
+        if (dynamic_cast<ACall*> (fn-> code.Nth(i)) || (call && byLabel.count(call-> GetLabel())))
+            fn-> leaf = false;
+    }
+    FindFormals(&fn-> code, &fn-> formals);
+}
+
+/* Function: Expand
+ * ----------------
+ * Appends to out the callee's body in place of the call: the arguments
+ * copied into the callee's formals, then its TACs renamed into the
+ * caller's frame. A Return becomes a copy into the call's result and a
+ * jump past the end.
+ */
+static void Expand(const Function &callee, const CallSite &site, BeginFunc *frame,
+                   List<Instruction*> *out)
+{
+    FrameRenaming renaming(frame);
+    for (int f = 0; f < (int)callee.formals.size(); f++)
+        out-> Append(new Assign(renaming.RenameVar(callee.formals[f]), ArgumentFor(callee.formals[f], site)));
+    const char *end = NULL;
+    int last = callee.code.NumElements() - 2;       // before the EndFunc
+    for (int i = 2; i <= last; i++) {               // after the entry CallerLoad
+        Instruction *instr = callee.code.Nth(i);
+        if (!dynamic_cast<Return*> (instr)) {
+            out-> Append(instr-> Clone(&renaming));
+            continue;
+        }
+        Location *val;
+        if (site.result && instr-> GetGen(&val))
+            out-> Append(new Assign(site.result, renaming.RenameVar(val)));
+        if (i < last)
+            out-> Append(new Goto(end ? end : (end = CodeGenerator::NewLabel())));
+    }
+    if (end) out-> Append(new Label(end));
+}
+
+/* Function: MarkLoops
+ * -------------------
+ * Sets inLoop for each TAC of code between a label and a branch back
+ * to it, which is how the front end lays loops out.
+ */
+static void MarkLoops(List<Instruction*> *code, std::vector<char> *inLoop)
+{
+    std::unordered_map<const char*, int> labelAt;
+    std::vector<int> depth(code-> NumElements() + 1, 0);
+    for (int i = 0; i < code-> NumElements(); i++) {
+        Instruction *instr = code-> Nth(i);
+        const char *target = NULL;
+        if (Label *label = dynamic_cast<Label*> (instr)) labelAt[label-> GetLabel()] = i;
+        else if (Goto *gt = dynamic_cast<Goto*> (instr)) target = gt-> GetLabel();
+        else if (IfZ *ifz = dynamic_cast<IfZ*> (instr)) target = ifz-> GetLabel();
+        else if (IfCompare *cmp = dynamic_cast<IfCompare*> (instr)) target = cmp-> GetLabel();
+        else if (IfInBounds *check = dynamic_cast<IfInBounds*> (instr)) target = check-> GetLabel();
+        std::unordered_map<const char*, int>::iterator found;
+        if (target && (found = labelAt.find(target)) != labelAt.end()) {
+            depth[found-> second]++;
+            depth[i + 1]--;
+        }
+    }
+    inLoop-> assign(code-> NumElements(), false);
+    for (int i = 0, d = 0; i < code-> NumElements(); i++)
+        (*inLoop)[i] = ((d += depth[i]) > 0);
+}
+
+/* Function: InlineInto
+ * --------------------
+ * Replaces the calls in caller to the leaf functions among callees that
+ * are small enough with copies of their bodies, and returns how many it
+ * replaced. A body is small enough if it is no bigger than what a call
+ * costs to set up and return from, or somewhat bigger at a call made
+ * on every trip round a loop.
+ */
+static int InlineInto(Function *caller, const std::vector<Function> &callees,
+                      const std::unordered_map<const char*, int> &byLabel)
+{
+    List<Instruction*> *code = &caller-> code;
+    std::vector<char> inLoop;
+    MarkLoops(code, &inLoop);
+    BeginFunc *frame = dynamic_cast<BeginFunc*> (code-> Nth(0));
+    Assert(frame != NULL);
+    List<Instruction*> out;
+    int inlined = 0;
+    for (int i = 0; i < code-> NumElements(); i++) {
+        CallSite site;
+        std::unordered_map<const char*, int>::const_iterator c;
+        if (!dynamic_cast<CallerSave*> (code-> Nth(i)) || !MatchCall(code, i, &site) ||
+            !site.label || (c = byLabel.find(site.label)) == byLabel.end()) {
+            out.Append(code-> Nth(i));
+            continue;
+        }
+        const Function &callee = callees[c-> second];
+        int size = callee.code.NumElements() - 3;   // less BeginFunc, entry CallerLoad, EndFunc
+        bool fits = callee.leaf &&
+            size <= (inLoop[i] ? MaxInlineSizeInLoop : MaxInlineSize) &&
+            out.NumElements() + size + code-> NumElements() - i <= MaxCallerSize;
+        for (int f = 0; f < (int)callee.formals.size() && fits; f++)
+            fits = (ArgumentFor(callee.formals[f], site) != NULL);
+        if (!fits) {
+            out.Append(code-> Nth(i));
+            continue;
+        }
+        Expand(callee, site, frame, &out);
+        i = site.last;
+        inlined++;
+    }
+    if (inlined) *code = out;
+    return inlined;
+}
+
+
+/* Function: InlineCalls
+ * ---------------------
+ * Each round inlines from the functions as they were at its start, so
+ * that what a caller gets does not depend on the order functions come
+ * in. The program's code is then put back together with each function
+ * in its old place, and functions moved to match.
+ */
+void InlineCalls(List<Instruction*> *code, List<std::pair<int, int> > *functions)
+{
+    std::vector<Function> fns(functions-> NumElements());
+    std::unordered_map<const char*, int> byLabel;
+    for (int f = 0; f < functions-> NumElements(); f++) {
+        int begin = functions-> Nth(f).first, end = functions-> Nth(f).second;
+        for (int i = begin; i <= end; i++)
+            fns[f].code.Append(code-> Nth(i));
+        Label *label = dynamic_cast<Label*> (code-> Nth(begin - 1));
+        Assert(label != NULL);
+        byLabel[label-> GetLabel()] = f;
+    }
+
+    int inlined = 0;
+    for (int round = 0; round < MaxRounds; round++) {
+        for (int f = 0; f < (int)fns.size(); f++)
+            Summarize(&fns[f], byLabel);
+        std::vector<Function> callees(fns);
+        int n = 0;
+        for (int f = 0; f < (int)fns.size(); f++)
+            n += InlineInto(&fns[f], callees, byLabel);
+        if (n == 0) break;
+        inlined += n;
+    }
+    if (IsDebugOn("inline"))
+        fprintf(stderr, "inline: %d calls inlined\n", inlined);
+    if (inlined == 0) return;
+
+    List<Instruction*> program;
+    List<std::pair<int, int> > positions;
+    for (int i = 0, f = 0; i < code-> NumElements(); i++) {
+        if (f < functions-> NumElements() && functions-> Nth(f).first == i) {
+            int begin = program.NumElements();
+            program.AppendAll(fns[f].code);
+            positions.Append(std::make_pair(begin, program.NumElements() - 1));
+            i = functions-> Nth(f++).second;
+        } else
+            program.Append(code-> Nth(i));
+    }
+    *code = program;
+    *functions = positions;
+}
@@ -0,0 +1,48 @@
+/* File: interference.cc
+ * ---------------------
+ * Implementation of the per-function register interference graph.
+ */
+
+#include "interference.h"
+
+
+InterferenceGraph::InterferenceGraph(const std::vector<Location*> &vars) :
+    nodes(vars), matrix(vars.size(), BitVector(vars.size())), adjacency(vars.size()),
+    costs(vars.size(), 0), callsCrossed(vars.size(), 0)
+{
+    for (int i = 0; i < (int)nodes.size(); i++)
+        nodeIndex[nodes[i]] = i;
+}
+
+int InterferenceGraph::NodeFor(Location *loc) const
+{
+    std::unordered_map<Location*, int>::const_iterator found = nodeIndex.find(loc);
+    return found == nodeIndex.end() ? -1 : found->second;
+}
+
+void InterferenceGraph::AddClique(const BitVector &live)
+{
+    for (int n = live.NextSetBit(0); n != -1; n = live.NextSetBit(n + 1))
+        matrix[n].UnionWith(live);
+}
+
+bool InterferenceGraph::AddEdge(int a, int b)
+{
+    if (a == b || matrix[a].Test(b))
+        return false;
+    matrix[a].Set(b);
+    matrix[b].Set(a);
+    adjacency[a].push_back(b);
+    adjacency[b].push_back(a);
+    return true;
+}
+
+void InterferenceGraph::Finish()
+{
+    for (int n = 0; n < NumNodes(); n++) {
+        matrix[n].Reset(n); // a variable never interferes with itself
+        adjacency[n].clear();
+        for (int m = matrix[n].NextSetBit(0); m != -1; m = matrix[n].NextSetBit(m + 1))
+            adjacency[n].push_back(m);
+    }
+}
@@ -0,0 +1,75 @@
+/* File: interference.h
+ * --------------------
+ * The InterferenceGraph class records which variables of one function
+ * are live at the same time and so cannot share a register. Nodes are
+ * numbered densely in the order variables are added; edges are kept
+ * both as a bit matrix (for constant time Interferes queries and cheap
+ * duplicate suppression while building) and as adjacency lists (for
+ * visiting the neighbors of a node). The graph also records the copies
+ * between its variables, which the allocator tries to coalesce, and a
+ * spill cost per node. It lives only as long as the register
+ * allocation of its function.
+ */
+
+#ifndef _H_interference
+#define _H_interference
+
+#include <vector>
+#include <unordered_map>
+#include "bitvector.h"
+
+class Location;
+
+class InterferenceGraph {
+  private:
+    std::vector<Location*> nodes;
+    std::unordered_map<Location*, int> nodeIndex;
+    std::vector<BitVector> matrix;
+    std::vector<std::vector<int> > adjacency;
+    std::vector<std::pair<int, int> > moves;
+    std::vector<int> costs;
+    std::vector<int> callsCrossed;
+
+  public:
+           // Create a graph over the given variables, numbered in order
+    InterferenceGraph(const std::vector<Location*> &vars);
+
+    int NumNodes() const { return nodes.size(); }
+    Location *GetLocation(int n) const { return nodes[n]; }
+
+          // Returns the node for a variable, or -1 if it is not in the graph
+    int NodeFor(Location *loc) const;
+
+          // Makes every pair of members of the set interfere. Adjacency
+          // lists are not updated until Finish is called.
+    void AddClique(const BitVector &live);
+
+          // Makes a and b interfere, updating the adjacency lists at
+          // once. Returns false if they already did (or a == b). Can be
+          // used after Finish, as the coalescing allocator does.
+    bool AddEdge(int a, int b);
+
+          // Builds adjacency lists from the matrix once all edges are in
+    void Finish();
+
+    bool Interferes(int a, int b) const { return matrix[a].Test(b); }
+    const std::vector<int> &Neighbors(int n) const { return adjacency[n]; }
+    int Degree(int n) const { return adjacency[n].size(); }
+
+          // Records a copy dst = src between two nodes
+    void AddMove(int dst, int src)      { moves.push_back(std::make_pair(dst, src)); }
+    int NumMoves() const                { return moves.size(); }
+    std::pair<int, int> Move(int m) const { return moves[m]; }
+
+          // Spill cost is the number of times a node is read or written
+    void AddUse(int n)                  { costs[n]++; }
+    int SpillCost(int n) const          { return costs[n]; }
+
+          // Counts a call the node is live across, weighted by how often
+          // the call is expected to run. Nodes that cross calls often are
+          // better off in callee-saved registers.
+    void AddCallCrossed(int n, int weight) { callsCrossed[n] += weight; }
+    int CallsCrossed(int n) const       { return callsCrossed[n]; }
+};
+
+#endif
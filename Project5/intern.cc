@@ -0,0 +1,94 @@
+/* File: intern.cc
+ * ---------------
+ * Implementation of the string table: an open addressing hash table
+ * (linear probing, kept at most half full) whose slots hold IDs, with
+ * the strings and their hash codes kept in arrays indexed by ID. Each
+ * string is allocated together with its ID, which comes first.
+ */
+
+#include "intern.h"
+#include "utility.h"
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include <mutex>
+
+static std::vector<const char*> strings;    // indexed by ID
+static std::vector<unsigned> hashCodes;     // likewise
+static std::vector<int> slots;              // IDs, -1 for empty
+static std::mutex lock;
+
+// FNV-1a
+static unsigned HashString(const char *s)
+{
+    unsigned h = 2166136261u;
+    for (; *s; s++)
+        h = (h ^ (unsigned char)*s) * 16777619u;
+    return h;
+}
+
+// Index of the slot holding s, or of the empty slot where it belongs
+static int FindSlot(const char *s, unsigned h)
+{
+    int mask = slots.size() - 1;
+    for (int i = h & mask; ; i = (i + 1) & mask) {
+        int id = slots[i];
+        if (id == -1 || (hashCodes[id] == h && strcmp(strings[id], s) == 0))
+            return i;
+    }
+}
+
+static void Grow()
+{
+    std::vector<int> old(slots.size() * 2, -1);
+    slots.swap(old);
+    int mask = slots.size() - 1;
+    for (int id = 0; id < (int)strings.size(); id++) {
+        int i = hashCodes[id] & mask;
+        while (slots[i] != -1)
+            i = (i + 1) & mask;
+        slots[i] = id;
+    }
+}
+
+// Copies s into a new block laid out as [ID][characters], returning
+// the characters
+static const char *NewEntry(const char *s, int id)
+{
+    int len = strlen(s);
+    int *block = (int*)malloc(sizeof(int) + len + 1);
+    block[0] = id;
+    char *copy = (char*)(block + 1);
+    memcpy(copy, s, len + 1);
+    return copy;
+}
+
+const char *Intern(const char *s)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (slots.empty())
+        slots.assign(64, -1);
+    unsigned h = HashString(s);
+    int i = FindSlot(s, h);
+    if (slots[i] != -1)
+        return strings[slots[i]];
+    int id = strings.size();
+    strings.push_back(NewEntry(s, id));
+    hashCodes.push_back(h);
+    slots[i] = id;
+    if (2 * strings.size() > slots.size())
+        Grow();
+    return strings[id];
+}
+
+int InternString(const char *s)
+{
+    return InternedId(Intern(s));
+}
+
+const char *InternedString(int id)
+{
+    std::lock_guard<std::mutex> guard(lock);
+    Assert(id >= 0 && id < (int)strings.size());
+    return strings[id];
+}
@@ -0,0 +1,61 @@
+/* File: intern.h
+ * --------------
+ * A global table of strings in which each distinct string is stored
+ * once and given a small integer ID: 0, 1, 2, ... in the order strings
+ * are first seen. Tables keyed by name (see hashtable.h) can then hash
+ * and compare IDs instead of characters.
+ *
+ * Identifiers are interned as they are scanned, and the AST, TAC
+ * locations and labels all keep the table's copy, so two names are the
+ * same exactly when their pointers are equal. The ID of such a pointer
+ * is stored just in front of its characters (see InternedId()).
+ *
+ * The table is shared by the whole compiler and may be used from the
+ * back end's worker threads, so entering or finding a string takes a
+ * lock. Going from an interned pointer to its ID does not.
+ */
+
+#ifndef _H_intern
+#define _H_intern
+
+
+/* Function: Intern()
+ * Usage: name = Intern(buffer);
+ * -----------------------------
+ * Returns the table's copy of the given string, entering one if it has
+ * not been seen before. The copy is never freed, so callers can keep
+ * the pointer instead of making their own copy.
+ */
+const char *Intern(const char *s);
+
+
+/* Function: InternedId()
+ * Usage: int id = InternedId(name);
+ * ---------------------------------
+ * Returns the ID of a string returned by Intern(). It is read from in
+ * front of the characters, so it costs neither hashing nor the lock,
+ * but name must be the table's copy and not just an equal string.
+ */
+inline int InternedId(const char *name)
+{
+    return ((const int*)name)[-1];
+}
+
+
+/* Function: InternString()
+ * Usage: int id = InternString(name);
+ * -----------------------------------
+ * Returns the ID of the given string, entering a copy of it in the
+ * table if it has not been seen before.
+ */
+int InternString(const char *s);
+
+
+/* Function: InternedString()
+ * Usage: printf("%s", InternedString(id));
+ * ----------------------------------------
+ * Returns the table's copy of the string with the given ID.
+ */
+const char *InternedString(int id);
+
+#endif
@@ -0,0 +1,243 @@
+/* File: licm.cc
+ * -------------
+ * Loop-invariant code motion over the TAC of one function.
+ */
+
+#include "optimize.h"
+#include "cfg.h"
+#include "liveness.h"
+#include "tac.h"
+#include "codegen.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+
+  // A natural loop: its header and the blocks that reach a back edge
+  // to it without going through it, in reverse postorder
+struct Loop {
+    BasicBlock *header;
+    std::vector<BasicBlock*> blocks;
+    std::vector<char> contains;         // by block id
+    BasicBlock *preheader;              // where hoisted code goes, or NULL
+};
+
+
+/* Function: FindPreheader
+ * -----------------------
+ * Returns the block that code run once before the loop can be appended
+ * to, or NULL if there is none. Loops come out of ForStmt and WhileStmt
+ * with just one way in, falling into the header from the block laid out
+ * before it, so code appended to that block (after its branch, if it
+ * ends in one) runs exactly when the loop is entered. Any other shape
+ * is left alone.
+ */
+static BasicBlock *FindPreheader(Loop *loop)
+{
+    BasicBlock *header = loop-> header, *entry = NULL;
+    for (int i = 0; i < header-> preds.NumElements(); i++) {
+        BasicBlock *pred = header-> preds.Nth(i);
+        if (loop-> contains[pred-> id]) continue;
+        if (entry) return NULL;
+        entry = pred;
+    }
+    if (!entry || entry-> id != header-> id - 1) return NULL;
+    Label *top = dynamic_cast<Label*> (header-> First());
+    if (!top) return NULL;
+    const char *label = top-> GetLabel();
+    Goto *gt = dynamic_cast<Goto*> (entry-> Last());
+    IfZ *ifz = dynamic_cast<IfZ*> (entry-> Last());
+    IfCompare *cmp = dynamic_cast<IfCompare*> (entry-> Last());
+    IfInBounds *check = dynamic_cast<IfInBounds*> (entry-> Last());
+    if ((gt && gt-> GetLabel() == label) || (ifz && ifz-> GetLabel() == label) ||
+        (cmp && cmp-> GetLabel() == label) || (check && check-> GetLabel() == label))
+        return NULL;
+    return entry;
+}
+
+/* Function: FindLoops
+ * -------------------
+ * Fills loops with the natural loops of graph, outermost first. Back
+ * edges to the same header make one loop.
+ */
+static void FindLoops(FlowGraph *graph, std::vector<Loop> *loops)
+{
+    const std::vector<BasicBlock*> &order = graph-> ReversePostorder();
+    for (int k = 0; k < (int)order.size(); k++) {
+        BasicBlock *header = order[k];
+        std::vector<BasicBlock*> work;
+        for (int i = 0; i < header-> preds.NumElements(); i++)
+            if (graph-> Dominates(header, header-> preds.Nth(i)))
+                work.push_back(header-> preds.Nth(i));
+        if (work.empty()) continue;
+
+        Loop loop;
+        loop.header = header;
+        loop.contains.assign(graph-> NumBlocks(), false);
+        loop.contains[header-> id] = true;
+        while (!work.empty()) {
+            BasicBlock *block = work.back();
+            work.pop_back();
+            if (loop.contains[block-> id]) continue;
+            loop.contains[block-> id] = true;
+            for (int i = 0; i < block-> preds.NumElements(); i++)
+                work.push_back(block-> preds.Nth(i));
+        }
+        for (int j = k; j < (int)order.size(); j++)
+            if (loop.contains[order[j]-> id]) loop.blocks.push_back(order[j]);
+        loop.preheader = FindPreheader(&loop);
+        loops-> push_back(loop);
+    }
+}
+
+
+/* Class: LoopFacts
+ * ----------------
+ * What HoistFrom needs to know about the current code of one loop: how
+ * many times each variable is written in it and by what, and whether
+ * anything in it can write memory or globals.
+ */
+struct LoopFacts {
+    std::unordered_map<Location*, int> numDefs;
+    std::unordered_map<Location*, Instruction*> def;
+    bool writesMemory;                  // a store or a call
+    bool calls;
+
+    LoopFacts(Loop *loop);
+};
+
+LoopFacts::LoopFacts(Loop *loop) : writesMemory(false), calls(false)
+{
+    for (int b = 0; b < (int)loop-> blocks.size(); b++) {
+        BasicBlock *block = loop-> blocks[b];
+        for (int i = 0; i < block-> code.NumElements(); i++) {
+            Instruction *instr = block-> code.Nth(i);
+            if (Location *kill = instr-> GetKill()) {
+                numDefs[kill]++;
+                def[kill] = instr;
+            }
+            if (dynamic_cast<LCall*> (instr) || dynamic_cast<ACall*> (instr))
+                calls = writesMemory = true;
+            if (dynamic_cast<Store*> (instr))
+                writesMemory = true;
+        }
+    }
+}
+
+
+/* Function: IsInvariant
+ * ---------------------
+ * Returns true if instr computes the same value on every iteration and
+ * can be done once before the loop instead:
+ *   - it is pure, and if it can trap (overflow, division by zero, a bad
+ *     address) it runs on every trip through the loop anyway, before
+ *     anything the loop does that could be seen, so that trapping
+ *     ahead of the loop instead changes nothing but when;
+ *   - a load reads memory nothing in the loop writes, or an array's
+ *     length, which never changes once the array is made;
+ *   - each operand is written nowhere in the loop, or only by another
+ *     invariant TAC (and a global only if the loop makes no calls);
+ *   - it is the loop's only write to its frame variable, and the value
+ *     that variable had before the loop is not live at the header, so
+ *     no use in the loop can tell when the write happened.
+ */
+static bool IsInvariant(Instruction *instr, bool everyTrip, const LoopFacts &facts,
+                        const std::unordered_set<Instruction*> &invariant,
+                        const BitVector &liveAtHeader, const Liveness &liveness)
+{
+    Location *dst = instr-> GetKill();
+    if (!dst || dst-> GetSegment() != fpRelative) return false;
+    if (facts.numDefs.find(dst)-> second != 1 || liveAtHeader.Test(liveness.IndexOf(dst)))
+        return false;
+
+    if (BinaryOp *op = dynamic_cast<BinaryOp*> (instr)) {
+        BinaryOp::OpCode code = op-> GetOpCode();
+        bool traps = (code == BinaryOp::Add || code == BinaryOp::Sub ||
+                      code == BinaryOp::Div || code == BinaryOp::Mod);
+        if (traps && !everyTrip) return false;
+    } else if (Load *load = dynamic_cast<Load*> (instr)) {
+        if (!everyTrip || (facts.writesMemory && load-> GetOffset() != CodeGenerator::OffsetToArrayLength))
+            return false;
+    } else if (!dynamic_cast<LoadConstant*> (instr) && !dynamic_cast<LoadLabel*> (instr) &&
+               !dynamic_cast<LoadStringConstant*> (instr) && !dynamic_cast<Assign*> (instr))
+        return false;
+
+    Location *gen[Instruction::MaxGen];
+    int numGen = instr-> GetGen(gen);
+    for (int j = 0; j < numGen; j++) {
+        std::unordered_map<Location*, int>::const_iterator n = facts.numDefs.find(gen[j]);
+        if (n == facts.numDefs.end()) {
+            if (gen[j]-> GetSegment() != fpRelative && facts.calls) return false;
+        } else if (n-> second != 1 || !invariant.count(facts.def.find(gen[j])-> second))
+            return false;
+    }
+    return true;
+}
+
+/* Function: HoistFrom
+ * -------------------
+ * Finds the loop's invariant TACs, repeating the scan while it finds
+ * more since one can make another's operand invariant, then moves them
+ * in the order found to the end of the preheader. Returns how many
+ * moved. The TACs that run on every trip before any effect are taken
+ * to be those of the header up to its first call or store: the header
+ * runs whenever the loop is entered, and a call may print.
+ */
+static int HoistFrom(Loop *loop, const Liveness &liveness)
+{
+    LoopFacts facts(loop);
+    const BitVector &liveAtHeader = liveness.LiveIn(loop-> header);
+    std::vector<Instruction*> order;
+    std::unordered_set<Instruction*> invariant;
+    for (bool found = true; found; ) {
+        found = false;
+        for (int b = 0; b < (int)loop-> blocks.size(); b++) {
+            BasicBlock *block = loop-> blocks[b];
+            bool everyTrip = (block == loop-> header);
+            for (int i = 0; i < block-> code.NumElements(); i++) {
+                Instruction *instr = block-> code.Nth(i);
+                if (dynamic_cast<LCall*> (instr) || dynamic_cast<ACall*> (instr) ||
+                    dynamic_cast<Store*> (instr))
+                    everyTrip = false;
+                if (invariant.count(instr) ||
+                    !IsInvariant(instr, everyTrip, facts, invariant, liveAtHeader, liveness))
+                    continue;
+                invariant.insert(instr);
+                order.push_back(instr);
+                found = true;
+            }
+        }
+    }
+    if (order.empty()) return 0;
+
+    for (int b = 0; b < (int)loop-> blocks.size(); b++) {
+        List<Instruction*> *code = &loop-> blocks[b]-> code;
+        for (int i = code-> NumElements() - 1; i >= 0; i--)
+            if (invariant.count(code-> Nth(i))) code-> RemoveAt(i);
+    }
+    for (int i = 0; i < (int)order.size(); i++)
+        loop-> preheader-> code.Append(order[i]);
+    return order.size();
+}
+
+/* Function: HoistInvariants
+ * -------------------------
+ * Loops are done outermost first, so that what is invariant in an
+ * outer loop leaves all of them at once; an inner loop then only sees
+ * what stayed behind. The liveness used throughout is that of the code
+ * before anything moved, which hoisting does not change for the TACs
+ * still to be considered.
+ */
+bool HoistInvariants(List<Instruction*> *tac)
+{
+    FlowGraph graph(tac, 0, tac-> NumElements() - 1);
+    std::vector<Loop> loops;
+    FindLoops(&graph, &loops);
+    if (loops.empty()) return false;
+    Liveness liveness(&graph);
+    int moved = 0;
+    for (int i = 0; i < (int)loops.size(); i++)
+        if (loops[i].preheader) moved += HoistFrom(&loops[i], liveness);
+    Relayout(&graph, tac);
+    return moved > 0;
+}
@@ -3,10 +3,14 @@
  * Simple list class for storing a linear collection of elements. It
  * supports operations similar in name to the CS107 DArray -- nth, insert,
  * append, remove, etc.  This class is nothing more than a very thin
- * cover of a STL deque, with some added range-checking. Given not everyone
+ * cover of a STL vector, with some added range-checking. Given not everyone
  * is familiar with the C++ templates, this class provides a more familiar
  * interface.
  *
+ * A list normally keeps its elements on the heap, but one made with
+ * an arena (see arena.h) keeps them there instead; the parser does
+ * this for the lists of children in the AST.
+ *
  * It can handle elements of any type, the typename for a List includes the
  * element type in angle brackets, e.g.  to store elements of type double,
  * you would use the type name List<double>, to store elements of type
@@ -28,10 +32,11 @@
 #ifndef _H_list
 #define _H_list
 
-#include <deque>
+#include <vector>
 #include <algorithm>
 #include "utility.h"  // for Assert()
 #include "scope.h"
+#include "arena.h"
   
 class Node;
 class CodeGenerator;
@@ -39,11 +44,13 @@ class CodeGenerator;
 template<class Element> class List {
 
  private:
-    std::deque<Element> elems;
+    std::vector<Element, ArenaAllocator<Element> > elems;
 
  public:
            // Create a new empty list
     List() {}
+           // Create a new empty list whose elements go in arena
+    List(Arena *arena) : elems(ArenaAllocator<Element>(arena)) {}
            // Copy a list
     List(const List<Element> &lst) : elems(lst.elems) {}
 
@@ -0,0 +1,85 @@
+/* File: liveness.cc
+ * -----------------
+ * Implementation of live variable analysis over basic blocks.
+ */
+
+#include "liveness.h"
+#include "cfg.h"
+#include "tac.h"
+
+
+/* Method: Liveness
+ * ----------------
+ * Variables are numbered in order of first mention. Liveness is then a
+ * backward bit-vector problem over the blocks: a block's gen is the
+ * variables it reads before writing them, its kill the variables it
+ * writes.
+ */
+Liveness::Liveness(FlowGraph *graph)
+{
+    for (int b = 0; b < graph-> NumBlocks(); b++) {
+        List<Instruction*> *tacs = &graph-> Block(b)-> code;
+        for (int i = 0; i < tacs-> NumElements(); i++) {
+            Location *gen[Instruction::MaxGen], *kill = tacs-> Nth(i)-> GetKill();
+            int numGen = tacs-> Nth(i)-> GetGen(gen);
+            for (int j = -1; j < numGen; j++) {
+                Location *var = (j == -1) ? kill : gen[j];
+                if (var && varIndex.insert(std::make_pair(var, (int)vars.size())).second)
+                    vars.push_back(var);
+            }
+        }
+    }
+
+    solution = new Dataflow(graph-> NumBlocks(), vars.size(), Dataflow::Backward);
+    for (int b = 0; b < graph-> NumBlocks(); b++) {
+        BasicBlock *block = graph-> Block(b);
+        for (int j = 0; j < block-> succs.NumElements(); j++)
+            solution-> AddEdge(b, block-> succs.Nth(j)-> id);
+        BitVector *blockGen = solution-> Gen(b), *blockKill = solution-> Kill(b);
+        for (int i = block-> code.NumElements() - 1; i >= 0; i--) {
+            StepBack(block-> code.Nth(i), blockGen);
+            if (Location *kill = block-> code.Nth(i)-> GetKill())
+                blockKill-> Set(varIndex[kill]);
+        }
+    }
+    solution-> Solve();
+}
+
+Liveness::~Liveness()
+{
+    delete solution;
+}
+
+int Liveness::IndexOf(Location *var) const
+{
+    std::unordered_map<Location*, int>::const_iterator found = varIndex.find(var);
+    return found == varIndex.end() ? -1 : found-> second;
+}
+
+const BitVector &Liveness::LiveIn(BasicBlock *block) const
+{
+    return solution-> In(block-> id);
+}
+
+const BitVector &Liveness::LiveOut(BasicBlock *block) const
+{
+    return solution-> Out(block-> id);
+}
+
+void Liveness::StepBack(Instruction *tac, BitVector *live) const
+{
+    Location *gen[Instruction::MaxGen], *kill = tac-> GetKill();
+    int numGen = tac-> GetGen(gen);
+    if (kill) live-> Reset(IndexOf(kill));
+    for (int j = 0; j < numGen; j++)
+        live-> Set(IndexOf(gen[j]));
+}
+
+
+void LiveAtTac::Record(int n, const BitVector &live, const Liveness &liveness)
+{
+    first[n] = vars.size();
+    for (int v = live.NextSetBit(0); v != -1; v = live.NextSetBit(v + 1))
+        vars.push_back(liveness.Var(v));
+    last[n] = vars.size();
+}
@@ -0,0 +1,79 @@
+/* File: liveness.h
+ * ----------------
+ * The Liveness class solves live variable analysis for one function's
+ * FlowGraph. Every variable the function reads or writes is given a
+ * dense number, and the sets live on entry to and exit from each block
+ * are kept as BitVectors over those numbers.
+ *
+ * Sets inside a block are recovered by walking it backwards from its
+ * live-out set with StepBack:
+ *
+ *       BitVector live = liveness.LiveOut(block);
+ *       for (int i = block->code.NumElements() - 1; i >= 0; i--) {
+ *           ... live is what is live just after block->code.Nth(i) ...
+ *           liveness.StepBack(block->code.Nth(i), &live);
+ *       }
+ */
+
+#ifndef _H_liveness
+#define _H_liveness
+
+#include <vector>
+#include <unordered_map>
+#include "bitvector.h"
+#include "dataflow.h"
+
+class FlowGraph;
+class BasicBlock;
+class Instruction;
+class Location;
+
+class Liveness {
+  private:
+    std::vector<Location*> vars;
+    std::unordered_map<Location*, int> varIndex;
+    Dataflow *solution;
+
+  public:
+          // Numbers the variables of the graph and solves liveness for it
+    Liveness(FlowGraph *graph);
+    ~Liveness();
+
+    int NumVars() const                 { return vars.size(); }
+    Location *Var(int v) const          { return vars[v]; }
+
+          // Returns the number of a variable, or -1 if the function never
+          // mentions it
+    int IndexOf(Location *var) const;
+
+    const BitVector &LiveIn(BasicBlock *block) const;
+    const BitVector &LiveOut(BasicBlock *block) const;
+
+          // Turns the set live just after tac into the set live just
+          // before it
+    void StepBack(Instruction *tac, BitVector *live) const;
+};
+
+
+// The variables live just before or just after each TAC of a function
+// (the union of its IN and OUT), as recorded by the code generator.
+// TACs are numbered in block order, and the variables of each are a run
+// of one flat array, so the table costs a few allocations however big
+// the function is, and nothing once the function is done.
+class LiveAtTac {
+  private:
+    std::vector<int> first, last;   // run of each TAC in vars
+    std::vector<Location*> vars;
+
+  public:
+    LiveAtTac(int numTacs) : first(numTacs), last(numTacs) {}
+
+          // Records the variables in live, in numbering order, as those
+          // of TAC n
+    void Record(int n, const BitVector &live, const Liveness &liveness);
+
+    int NumLive(int n) const            { return last[n] - first[n]; }
+    Location *Live(int n, int i) const  { return vars[first[n] + i]; }
+};
+
+#endif
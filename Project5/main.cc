@@ -9,6 +9,8 @@
 #include "utility.h"
 #include "errors.h"
 #include "parser.h"
+#include "arena.h"
+#include "output.h"
 
 void SysCallCodeGen();
 
@@ -19,7 +21,8 @@ void SysCallCodeGen();
  * on any debugging flags requested by the user when invoking the program.
  * InitScanner() is used to set up the scanner.
  * InitParser() is used to set up the parser. The call to yyparse() will
- * attempt to parse a complete program from the input. 
+ * attempt to parse a complete program from the input. The whole AST
+ * and TAC are freed in one go at the end.
  */
 int main(int argc, char *argv[])
 {
@@ -32,162 +35,169 @@ int main(int argc, char *argv[])
 	ReportError::PrintErrors();
     if (ReportError::NumErrors() == 0)
 	SysCallCodeGen();
+    AsmOutput()->Flush();
+    TacArena()->Release();
+    AstArena()->Release();
     return (ReportError::NumErrors() == 0? 0 : -1);
 }
 
+// The runtime library the generated code calls, which goes out after it
+static const char *runtime =
+    "  _PrintInt:\n"
+    "	  subu $sp, $sp, 8	# decrement sp to make space to save ra,fp\n"
+    "	  sw $fp, 8($sp)	# save fp\n"
+    "	  sw $ra, 4($sp)	# save ra\n"
+    "	  addiu $fp, $sp, 8	# set up new fp\n"
+    "	  lw $a0, 4($fp)	# fill a from $fp+4\n"
+    "	# LCall _PrintInt\n"
+    "	  li $v0, 1\n"
+    "	  syscall\n"
+    "	# EndFunc\n"
+    "	# (below handles reaching end of fn body with no explicit return)\n"
+    "	  move $sp, $fp		# pop callee frame off stack\n"
+    "	  lw $ra, -4($fp)	# restore saved ra\n"
+    "	  lw $fp, 0($fp)	# restore saved fp\n"
+    "	  jr $ra		# return from function\n"
+    "\n"
+    "  _ReadInteger:\n"
+    "	  subu $sp, $sp, 8	# decrement sp to make space to save ra,fp\n"
+    "	  sw $fp, 8($sp)	# save fp\n"
+    "	  sw $ra, 4($sp)	# save ra\n"
+    "	  addiu $fp, $sp, 8	# set up new fp\n"
+    "	  li $v0, 5\n"
+    "	  syscall\n"
+    "	# EndFunc\n"
+    "	# (below handles reaching end of fn body with no explicit return)\n"
+    "	  move $sp, $fp		# pop callee frame off stack\n"
+    "	  lw $ra, -4($fp)	# restore saved ra\n"
+    "	  lw $fp, 0($fp)	# restore saved fp\n"
+    "	  jr $ra		# return from function\n"
+    "\n"
+    "\n"
+    "  _PrintBool:\n"
+    "	  subu $sp, $sp, 8      # decrement sp to make space to save ra, fp\n"
+    "	  sw $fp, 8($sp)        # save fp\n"
+    "	  sw $ra, 4($sp)        # save ra\n"
+    "	  addiu $fp, $sp, 8     # set up new fp\n"
+    "	  lw $a0, 4($fp)        # fill a from $fp+4\n"
+    "	  li $v0, 4\n"
+    "	  beq $a0, $0, PrintBoolFalse\n"
+    "	  la $a0, _PrintBoolTrueString\n"
+    "	  j PrintBoolEnd\n"
+    "  PrintBoolFalse:\n"
+    " 	  la $a0, _PrintBoolFalseString\n"
+    "  PrintBoolEnd:\n"
+    "	  syscall\n"
+    "	# EndFunc\n"
+    "	# (below handles reaching end of fn body with no explicit return)\n"
+    "	  move $sp, $fp         # pop callee frame off stack\n"
+    "	  lw $ra, -4($fp)       # restore saved ra\n"
+    "	  lw $fp, 0($fp)        # restore saved fp\n"
+    "	  jr $ra                # return from function\n"
+    "\n"
+    "      .data			# create string constant marked with label\n"
+    "      _PrintBoolTrueString: .asciiz \"true\"\n"
+    "      .text\n"
+    "\n"
+    "      .data			# create string constant marked with label\n"
+    "      _PrintBoolFalseString: .asciiz \"false\"\n"
+    "      .text\n"
+    "\n"
+    "  _PrintString:\n"
+    "	  subu $sp, $sp, 8      # decrement sp to make space to save ra, fp\n"
+    "	  sw $fp, 8($sp)        # save fp\n"
+    "	  sw $ra, 4($sp)        # save ra\n"
+    "	  addiu $fp, $sp, 8     # set up new fp\n"
+    "	  lw $a0, 4($fp)        # fill a from $fp+4\n"
+    "	  li $v0, 4\n"
+    "	  syscall\n"
+    "	# EndFunc\n"
+    "	# (below handles reaching end of fn body with no explicit return)\n"
+    "	  move $sp, $fp         # pop callee frame off stack\n"
+    "	  lw $ra, -4($fp)       # restore saved ra\n"
+    "	  lw $fp, 0($fp)        # restore saved fp\n"
+    "	  jr $ra                # return from function\n"
+    "\n"
+    "  _Alloc:\n"
+    "	  subu $sp, $sp, 8      # decrement sp to make space to save ra,fp\n"
+    "	  sw $fp, 8($sp)        # save fp\n"
+    "	  sw $ra, 4($sp)        # save ra\n"
+    "	  addiu $fp, $sp, 8     # set up new fp\n"
+    "	  lw $a0, 4($fp)        # fill a from $fp+4\n"
+    "	  li $v0, 9\n"
+    "	  syscall\n"
+    "	# EndFunc\n"
+    "	# (below handles reaching end of fn body with no explicit return)\n"
+    "	  move $sp, $fp         # pop callee frame off stack\n"
+    "	  lw $ra, -4($fp)       # restore saved ra\n"
+    "	  lw $fp, 0($fp)        # restore saved fp\n"
+    "	  jr $ra                # return from function\n"
+    "\n"
+    "  _Halt:\n"
+    "	  li $v0, 10\n"
+    "	  syscall\n"
+    "	# EndFunc\n"
+    "\n"
+    "\n"
+    "  _StringEqual:\n"
+    "	  subu $sp, $sp, 8      # decrement sp to make space to save ra, fp\n"
+    "	  sw $fp, 8($sp)        # save fp\n"
+    "	  sw $ra, 4($sp)        # save ra\n"
+    "	  addiu $fp, $sp, 8     # set up new fp\n"
+    "	  lw $a0, 4($fp)        # fill a from $fp+4\n"
+    "	  lw $a1, 8($fp)        # fill a from $fp+8\n"
+    "	  beq $a0,$a1,Lrunt10\n"
+    "  Lrunt12:\n"
+    "	  lbu  $v0,($a0)\n"
+    "	  lbu  $a2,($a1)\n"
+    "	  bne $v0,$a2,Lrunt11\n"
+    "	  addiu $a0,$a0,1\n"
+    "	  addiu $a1,$a1,1\n"
+    "	  bne $v0,$0,Lrunt12\n"
+    "      li  $v0,1\n"
+    "      j Lrunt10\n"
+    "  Lrunt11:\n"
+    "	  li  $v0,0\n"
+    "  Lrunt10:\n"
+    "	# EndFunc\n"
+    "	# (below handles reaching end of fn body with no explicit return)\n"
+    "	  move $sp, $fp         # pop callee frame off stack\n"
+    "	  lw $ra, -4($fp)       # restore saved ra\n"
+    "	  lw $fp, 0($fp)        # restore saved fp\n"
+    "	  jr $ra                # return from function\n"
+    "\n"
+    "\n"
+    "\n"
+    "  _ReadLine:\n"
+    "	  subu $sp, $sp, 8      # decrement sp to make space to save ra, fp\n"
+    "	  sw $fp, 8($sp)        # save fp\n"
+    "	  sw $ra, 4($sp)        # save ra\n"
+    "	  addiu $fp, $sp, 8     # set up new fp\n"
+    "	  li $a0, 101\n"
+    "	  li $v0, 9\n"
+    "	  syscall\n"
+    "	  addi $a0, $v0, 0\n"
+    "	  li $v0, 8\n"
+    "	  li $a1,101 \n"
+    "	  syscall\n"
+    "	  addiu $v0,$a0,0       # pointer to begin of string\n"
+    "  Lrunt21:\n"
+    "	  lb $a1,($a0)          # load character at pointer\n"
+    "	  addiu $a0,$a0,1       # forward pointer\n"
+    "	  bnez $a1,Lrunt21      # loop until end of string is reached\n"
+    "	  lb $a1,-2($a0)        # load character before end of string\n"
+    "	  li $a2,10             # newline character"
+    "	  bneq $a1,$a2,Lrunt20  # do not remove last character if not newline\n"
+    "	  sb $0,-2($a0)         # Add the terminating character in its place\n"
+    "  Lrunt20:\n"
+    "	# EndFunc\n"
+    "	# (below handles reaching end of fn body with no explicit return)\n"
+    "	  move $sp, $fp         # pop callee frame off stack\n"
+    "	  lw $ra, -4($fp)       # restore saved ra\n"
+    "	  lw $fp, 0($fp)        # restore saved fp\n"
+    "	  jr $ra                # return from function\n";
+
 void SysCallCodeGen()
 {
-    printf("  _PrintInt:\n");
-    printf("	  subu $sp, $sp, 8	# decrement sp to make space to save ra,fp\n");
-    printf("	  sw $fp, 8($sp)	# save fp\n");
-    printf("	  sw $ra, 4($sp)	# save ra\n");
-    printf("	  addiu $fp, $sp, 8	# set up new fp\n");
-    printf("	  lw $a0, 4($fp)	# fill a from $fp+4\n");
-    printf("	# LCall _PrintInt\n");
-    printf("	  li $v0, 1\n");
-    printf("	  syscall\n");
-    printf("	# EndFunc\n");
-    printf("	# (below handles reaching end of fn body with no explicit return)\n");
-    printf("	  move $sp, $fp		# pop callee frame off stack\n");
-    printf("	  lw $ra, -4($fp)	# restore saved ra\n");
-    printf("	  lw $fp, 0($fp)	# restore saved fp\n");
-    printf("	  jr $ra		# return from function\n");
-    printf("\n");
-    printf("  _ReadInteger:\n");
-    printf("	  subu $sp, $sp, 8	# decrement sp to make space to save ra,fp\n");
-    printf("	  sw $fp, 8($sp)	# save fp\n");
-    printf("	  sw $ra, 4($sp)	# save ra\n");
-    printf("	  addiu $fp, $sp, 8	# set up new fp\n");
-    printf("	  li $v0, 5\n");
-    printf("	  syscall\n");
-    printf("	# EndFunc\n");
-    printf("	# (below handles reaching end of fn body with no explicit return)\n");
-    printf("	  move $sp, $fp		# pop callee frame off stack\n");
-    printf("	  lw $ra, -4($fp)	# restore saved ra\n");
-    printf("	  lw $fp, 0($fp)	# restore saved fp\n");
-    printf("	  jr $ra		# return from function\n");
-    printf("\n");
-    printf("\n");
-    printf("  _PrintBool:\n");
-    printf("	  subu $sp, $sp, 8      # decrement sp to make space to save ra, fp\n");
-    printf("	  sw $fp, 8($sp)        # save fp\n");
-    printf("	  sw $ra, 4($sp)        # save ra\n");
-    printf("	  addiu $fp, $sp, 8     # set up new fp\n");
-    printf("	  lw $a0, 4($fp)        # fill a from $fp+4\n");
-    printf("	  li $v0, 4\n");
-    printf("	  beq $a0, $0, PrintBoolFalse\n");
-    printf("	  la $a0, _PrintBoolTrueString\n");
-    printf("	  j PrintBoolEnd\n");
-    printf("  PrintBoolFalse:\n");
-    printf(" 	  la $a0, _PrintBoolFalseString\n");
-    printf("  PrintBoolEnd:\n");
-    printf("	  syscall\n");
-    printf("	# EndFunc\n");
-    printf("	# (below handles reaching end of fn body with no explicit return)\n");
-    printf("	  move $sp, $fp         # pop callee frame off stack\n");
-    printf("	  lw $ra, -4($fp)       # restore saved ra\n");
-    printf("	  lw $fp, 0($fp)        # restore saved fp\n");
-    printf("	  jr $ra                # return from function\n");
-    printf("\n");
-    printf("      .data			# create string constant marked with label\n");
-    printf("      _PrintBoolTrueString: .asciiz \"true\"\n");
-    printf("      .text\n");
-    printf("\n");
-    printf("      .data			# create string constant marked with label\n");
-    printf("      _PrintBoolFalseString: .asciiz \"false\"\n");
-    printf("      .text\n");
-    printf("\n");
-    printf("  _PrintString:\n");
-    printf("	  subu $sp, $sp, 8      # decrement sp to make space to save ra, fp\n");
-    printf("	  sw $fp, 8($sp)        # save fp\n");
-    printf("	  sw $ra, 4($sp)        # save ra\n");
-    printf("	  addiu $fp, $sp, 8     # set up new fp\n");
-    printf("	  lw $a0, 4($fp)        # fill a from $fp+4\n");
-    printf("	  li $v0, 4\n");
-    printf("	  syscall\n");
-    printf("	# EndFunc\n");
-    printf("	# (below handles reaching end of fn body with no explicit return)\n");
-    printf("	  move $sp, $fp         # pop callee frame off stack\n");
-    printf("	  lw $ra, -4($fp)       # restore saved ra\n");
-    printf("	  lw $fp, 0($fp)        # restore saved fp\n");
-    printf("	  jr $ra                # return from function\n");
-    printf("\n");
-    printf("  _Alloc:\n");
-    printf("	  subu $sp, $sp, 8      # decrement sp to make space to save ra,fp\n");
-    printf("	  sw $fp, 8($sp)        # save fp\n");
-    printf("	  sw $ra, 4($sp)        # save ra\n");
-    printf("	  addiu $fp, $sp, 8     # set up new fp\n");
-    printf("	  lw $a0, 4($fp)        # fill a from $fp+4\n");
-    printf("	  li $v0, 9\n");
-    printf("	  syscall\n");
-    printf("	# EndFunc\n");
-    printf("	# (below handles reaching end of fn body with no explicit return)\n");
-    printf("	  move $sp, $fp         # pop callee frame off stack\n");
-    printf("	  lw $ra, -4($fp)       # restore saved ra\n");
-    printf("	  lw $fp, 0($fp)        # restore saved fp\n");
-    printf("	  jr $ra                # return from function\n");
-    printf("\n");
-    printf("  _Halt:\n");
-    printf("	  li $v0, 10\n");
-    printf("	  syscall\n");
-    printf("	# EndFunc\n");
-    printf("\n");
-    printf("\n");
-    printf("  _StringEqual:\n");
-    printf("	  subu $sp, $sp, 8      # decrement sp to make space to save ra, fp\n");
-    printf("	  sw $fp, 8($sp)        # save fp\n");
-    printf("	  sw $ra, 4($sp)        # save ra\n");
-    printf("	  addiu $fp, $sp, 8     # set up new fp\n");
-    printf("	  lw $a0, 4($fp)        # fill a from $fp+4\n");
-    printf("	  lw $a1, 8($fp)        # fill a from $fp+8\n");
-    printf("	  beq $a0,$a1,Lrunt10\n");
-    printf("  Lrunt12:\n");
-    printf("	  lbu  $v0,($a0)\n");
-    printf("	  lbu  $a2,($a1)\n");
-    printf("	  bne $v0,$a2,Lrunt11\n");
-    printf("	  addiu $a0,$a0,1\n");
-    printf("	  addiu $a1,$a1,1\n");
-    printf("	  bne $v0,$0,Lrunt12\n");
-    printf("      li  $v0,1\n");
-    printf("      j Lrunt10\n");
-    printf("  Lrunt11:\n");
-    printf("	  li  $v0,0\n");
-    printf("  Lrunt10:\n");
-    printf("	# EndFunc\n");
-    printf("	# (below handles reaching end of fn body with no explicit return)\n");
-    printf("	  move $sp, $fp         # pop callee frame off stack\n");
-    printf("	  lw $ra, -4($fp)       # restore saved ra\n");
-    printf("	  lw $fp, 0($fp)        # restore saved fp\n");
-    printf("	  jr $ra                # return from function\n");
-    printf("\n");
-    printf("\n");
-    printf("\n");
-    printf("  _ReadLine:\n");
-    printf("	  subu $sp, $sp, 8      # decrement sp to make space to save ra, fp\n");
-    printf("	  sw $fp, 8($sp)        # save fp\n");
-    printf("	  sw $ra, 4($sp)        # save ra\n");
-    printf("	  addiu $fp, $sp, 8     # set up new fp\n");
-    printf("	  li $a0, 101\n");
-    printf("	  li $v0, 9\n");
-    printf("	  syscall\n");
-    printf("	  addi $a0, $v0, 0\n");
-    printf("	  li $v0, 8\n");
-    printf("	  li $a1,101 \n");
-    printf("	  syscall\n");
-    printf("	  addiu $v0,$a0,0       # pointer to begin of string\n");
-    printf("  Lrunt21:\n");
-    printf("	  lb $a1,($a0)          # load character at pointer\n");
-    printf("	  addiu $a0,$a0,1       # forward pointer\n");
-    printf("	  bnez $a1,Lrunt21      # loop until end of string is reached\n");
-    printf("	  lb $a1,-2($a0)        # load character before end of string\n");
-    printf("	  li $a2,10             # newline character");
-    printf("	  bneq $a1,$a2,Lrunt20  # do not remove last character if not newline\n");
-    printf("	  sb $0,-2($a0)         # Add the terminating character in its place\n");
-    printf("  Lrunt20:\n");
-    printf("	# EndFunc\n");
-    printf("	# (below handles reaching end of fn body with no explicit return)\n");
-    printf("	  move $sp, $fp         # pop callee frame off stack\n");
-    printf("	  lw $ra, -4($fp)       # restore saved ra\n");
-    printf("	  lw $fp, 0($fp)        # restore saved fp\n");
-    printf("	  jr $ra                # return from function\n");
+    AsmOutput()->Append(runtime);
 }
@@ -21,8 +21,13 @@
  */
 
 #include "mips.h"
+#include "interference.h"
+#include "regalloc.h"
+#include "codegen.h"
+#include "output.h"
 #include <stdarg.h>
 #include <string.h>
+#include <ctype.h>
 
 
 
@@ -32,7 +37,7 @@ static bool LocationsAreSame(Location *var1, Location *var2)
 {
    return (var1 == var2 ||
 	     (var1 && var2
-		&& !strcmp(var1->GetName(), var2->GetName())
+		&& var1->GetName() == var2->GetName()
 		&& var1->GetSegment()  == var2->GetSegment()
 		&& var1->GetOffset() == var2->GetOffset()));
 }
@@ -74,20 +79,47 @@ void Mips::FillRegister(Location *src, Register reg)
  * ------------
  * General purpose helper used to emit assembly instructions in
  * a reasonable tidy manner.  Takes printf-style formatting strings
- * and variable arguments.
+ * and variable arguments. Goes to AsmOutput() unless SetOutput has
+ * redirected it into a string. The line is put together in one buffer
+ * and appended in one go. With -terse, comment lines are dropped and
+ * trailing comments cut off (unless the line has a string in it, where
+ * a # may not start a comment).
  */
 void Mips::Emit(const char *fmt, ...)
 {
   va_list args;
-  char buf[1024];
-  
+  const int indent = 3;          // room for the "\t  " put in front
+  char buf[1024 + indent + 1];   // + 1 for a newline
+  char *text = buf + indent;
+
   va_start(args, fmt);
-  vsprintf(buf, fmt, args);
+  int len = vsnprintf(text, 1024, fmt, args);
   va_end(args);
-  if (buf[strlen(buf) - 1] != ':') printf("\t"); // don't tab in labels
-  if (buf[0] != '#') printf("  ");   // outdent comments a little
-  printf("%s", buf);
-  if (buf[strlen(buf)-1] != '\n') printf("\n"); // end with a newline
+  if (len >= 1024) len = 1023;
+  if (Terse()) {
+    char *comment = strchr(text, '#');
+    if (comment && !strchr(text, '"')) {
+      if (comment == text) return;
+      for (len = comment - text; len > 0 && isspace(text[len - 1]); len--)
+        ;
+    }
+  }
+  bool isLabel = (text[len - 1] == ':'), isComment = (text[0] == '#');
+  if (!isComment) { *--text = ' '; *--text = ' '; len += 2; } // outdent comments a little
+  if (!isLabel) { *--text = '\t'; len++; }      // don't tab in labels
+  if (text[len - 1] != '\n') text[len++] = '\n'; // end with a newline
+  if (holding)
+    peephole.Append(text, len);
+  else
+    Output(text, len);
+}
+
+void Mips::Output(const char *text, int len)
+{
+  if (output == NULL)
+    AsmOutput()->Append(text, len);
+  else
+    output->append(text, len);
 }
 
 
@@ -110,14 +142,12 @@ void Mips::EmitLoadConstant(Location *dst, int val)
  * ------------------------------
  * Used to assign a variable a pointer to string constant. Emits
  * assembly directives to create a new null-terminated string in the
- * data segment and assigns it a unique label. Slaves dst into a register
- * and loads that label address into the register.
+ * data segment under the given label, which the TAC picked to be unique.
+ * Slaves dst into a register and loads that label address into the
+ * register.
  */
-void Mips::EmitLoadStringConstant(Location *dst, const char *str)
+void Mips::EmitLoadStringConstant(Location *dst, const char *label, const char *str)
 {
-  static int strNum = 1;
-  char label[16];
-  sprintf(label, "_string%d", strNum++);
   Emit(".data\t\t\t# create string constant marked with label");
   Emit("%s: .asciiz %s", label, str);
   Emit(".text");
@@ -148,8 +178,10 @@ void Mips::EmitCopy(Location *dst, Location *src)
 {
   Register reg = allocation.count(src) ? allocation[src] : rd;
   if (!allocation.count(src)) FillRegister(src, reg);
-  if (allocation.count(dst))
-    Emit("move %s, %s\t# copy regs", regs[allocation[dst]].name, regs[reg].name);
+  if (allocation.count(dst)) {
+    if (allocation[dst] != reg) // coalesced copies need no move
+      Emit("move %s, %s\t# copy regs", regs[allocation[dst]].name, regs[reg].name);
+  }
   else SpillRegister(dst, reg);
 }
 
@@ -256,6 +288,41 @@ void Mips::EmitIfZ(Location *test, const char *label)
 }
 
 
+/* Method: EmitIfCompare
+ * ----------------------
+ * Used for a conditional branch on a comparison, which is one of the
+ * compare-and-branch instructions.
+ */
+void Mips::EmitIfCompare(IfCompare::Condition cond, Location *op1, Location *op2,
+                         const char *label)
+{
+  static const char *branch[IfCompare::NumConds] = {"beq", "bne", "blt", "ble", "bgt", "bge"};
+  Register reg1 = allocation.count(op1) ? allocation[op1] : rs;
+  Register reg2 = allocation.count(op2) ? allocation[op2] : rt;
+  if (!allocation.count(op1)) FillRegister(op1, reg1);
+  if (!allocation.count(op2)) FillRegister(op2, reg2);
+  Emit("%s %s, %s, %s\t# branch if %s %s %s", branch[cond], regs[reg1].name,
+       regs[reg2].name, label, op1->GetName(), IfCompare::condName[cond], op2->GetName());
+}
+
+
+/* Method: EmitIfInBounds
+ * ----------------------
+ * Used for an array bounds check: branches if 0 <= index < count. The
+ * unsigned compare sees a negative index as a huge one, so one bltu
+ * does both tests.
+ */
+void Mips::EmitIfInBounds(Location *index, Location *count, const char *label)
+{
+  Register reg1 = allocation.count(index) ? allocation[index] : rs;
+  Register reg2 = allocation.count(count) ? allocation[count] : rt;
+  if (!allocation.count(index)) FillRegister(index, reg1);
+  if (!allocation.count(count)) FillRegister(count, reg2);
+  Emit("bltu %s, %s, %s	# branch if %s in bounds", regs[reg1].name,
+	 regs[reg2].name, label, index->GetName());
+}
+
+
 /* Method: EmitParam
  * -----------------
  * Used to push a parameter on the stack in anticipation of upcoming
@@ -272,6 +339,38 @@ void Mips::EmitParam(Location *arg)
 }
 
 
+/* Method: ReadForCall
+ * -------------------
+ * Returns the register holding var between the CallerSave and the jump
+ * of a call: its own, unless an earlier RegParam of the call has
+ * overwritten that, in which case var is filled into scratch.
+ */
+Mips::Register Mips::ReadForCall(Location *var, Register scratch)
+{
+  if (allocation.count(var) &&
+      !(allocation[var] >= a0 && allocation[var] < a0 + numRegParams))
+    return allocation[var];
+  FillRegister(var, scratch);
+  return scratch;
+}
+
+/* Method: EmitRegParam
+ * --------------------
+ * Used to pass a parameter in $a<n>. The RegParams of a call come
+ * after its PushParams, in order of n.
+ */
+void Mips::EmitRegParam(Location *arg, int n)
+{
+  Register reg = static_cast<Register>(a0 + n);
+  Assert(n == numRegParams);
+  Register src = ReadForCall(arg, reg);
+  if (src != reg)
+    Emit("move %s, %s\t\t# copy param value to %s", regs[reg].name,
+	 regs[src].name, regs[reg].name);
+  numRegParams++;
+}
+
+
 /* Method: EmitCallInstr
  * ---------------------
  * Used to effect a function call. All necessary arguments should have
@@ -287,6 +386,7 @@ void Mips::EmitCallInstr(Location *result, const char *fn, bool isLabel)
 {
 
   Emit("%s %-15s\t# jump to function", isLabel? "jal": "jalr", fn);
+  numRegParams = 0;
   // if (result != NULL) {
   //   Register reg = allocation.count(result) ? allocation[result] : rd;
   //   Emit("move %s, %s\t\t# copy function return value from $v0",
@@ -313,9 +413,7 @@ void Mips::EmitLCall(Location *dst, const char *label)
 
 void Mips::EmitACall(Location *dst, Location *fn)
 {
-  Register reg = allocation.count(fn) ? allocation[fn] : rs;
-  if (!allocation.count(fn)) FillRegister(fn, reg);
-  EmitCallInstr(dst, regs[reg].name, false);
+  EmitCallInstr(dst, regs[ReadForCall(fn, rs)].name, false);
 }
 
 /*
@@ -353,10 +451,53 @@ void Mips::EmitPopParams(int bytes)
       Emit("move $v0, %s\t\t# assign return value into $v0",
 	   regs[reg].name);
     }
+  EmitPopFrame();
+  Emit("jr $ra\t\t# return from function");
+}
+
+/* Method: EmitPopFrame
+ * --------------------
+ * Undoes what EmitBeginFunction did: restores the callee-saved
+ * registers, $sp, $ra and $fp to what they were on entry.
+ */
+void Mips::EmitPopFrame()
+{
+  for (int i = 0; i < (int)calleeSaved.size(); i++)
+    Emit("lw %s, %d($fp)\t# restore callee-saved register",
+         regs[calleeSaved[i]].name, calleeSaveOffset - 4*i);
   Emit("move $sp, $fp\t\t# pop callee frame off stack");
   Emit("lw $ra, -4($fp)\t# restore saved ra");
   Emit("lw $fp, 0($fp)\t# restore saved fp");
-  Emit("jr $ra\t\t# return from function");
+}
+
+/* Method: EmitTailCall
+ * --------------------
+ * Used to end a function by jumping to another (at label, or at the
+ * address in fnAddr) that is to return straight to our caller. The
+ * bytes of parameters just pushed for it are copied up into our own
+ * parameters' slots, and our frame popped, so that the callee finds
+ * the stack as if our caller had called it. Any parameters in $a0-$a3
+ * are already in place. The address of a method is moved to $v1 first,
+ * as popping the frame may reload the register holding it.
+ */
+void Mips::EmitTailCall(const char *label, Location *fnAddr, int bytes)
+{
+  if (fnAddr) {
+    Register reg = ReadForCall(fnAddr, rt);
+    if (reg != rt)
+      Emit("move %s, %s\t\t# hold method address", regs[rt].name, regs[reg].name);
+  }
+  for (int k = 0; k < bytes; k += 4) {
+    int offset = CodeGenerator::OffsetToFirstParam + k;
+    Emit("lw %s, %d($sp)\t# move param value to our own param slot", regs[rd].name, offset);
+    Emit("sw %s, %d($fp)", regs[rd].name, offset);
+  }
+  EmitPopFrame();
+  if (fnAddr)
+    Emit("jr %s\t\t# jump to method in our place", regs[rt].name);
+  else
+    Emit("j %-15s\t# jump to function in our place", label);
+  numRegParams = 0;
 }
 
 
@@ -366,11 +507,14 @@ void Mips::EmitPopParams(int bytes)
  * upon entering a new function. We decrement the $sp to make space
  * and then save the current values of $fp and $ra (since we are
  * going to change them), then set up the $fp and bump the $sp down
- * to make space for all our locals/temps.
+ * to make space for all our locals/temps. Below those go the callee-
+ * saved registers this function's allocation uses, which EmitReturn
+ * puts back.
  */
 void Mips::EmitBeginFunction(int stackFrameSize)
 {
   Assert(stackFrameSize >= 0);
+  holding = true;
   Emit("subu $sp, $sp, 8\t# decrement sp to make space to save ra, fp");
   Emit("sw $fp, 8($sp)\t# save fp");
   Emit("sw $ra, 4($sp)\t# save ra");
@@ -379,6 +523,14 @@ void Mips::EmitBeginFunction(int stackFrameSize)
   if (stackFrameSize != 0)
     Emit("subu $sp, $sp, %d\t# decrement sp to make space for locals/temps",
 	   stackFrameSize);
+
+  calleeSaveOffset = CodeGenerator::OffsetToFirstLocal - stackFrameSize;
+  if (!calleeSaved.empty())
+    Emit("subu $sp, $sp, %d\t# decrement sp to make space for callee-saved registers",
+	 4*(int)calleeSaved.size());
+  for (int i = 0; i < (int)calleeSaved.size(); i++)
+    Emit("sw %s, %d($fp)\t# save callee-saved register",
+         regs[calleeSaved[i]].name, calleeSaveOffset - 4*i);
 }
 
 
@@ -386,12 +538,17 @@ void Mips::EmitBeginFunction(int stackFrameSize)
  * -----------------------
  * Used to end the body of a function. Does an implicit return in fall off
  * case to clean up stack frame, return to caller etc. See comments on
- * EmitReturn above.
+ * EmitReturn above. The function's code, held since EmitBeginFunction,
+ * then goes through the peephole pass and out.
  */
 void Mips::EmitEndFunction()
 { 
   Emit("# (below handles reaching end of fn body with no explicit return)");
   EmitReturn(NULL);
+  std::string code;
+  peephole.Flush(&code);
+  holding = false;
+  Output(code.data(), code.size());
 }
 
 
@@ -448,6 +605,10 @@ const char *Mips::NameForTac(BinaryOp::OpCode code)
  * the initial starting state.
  */
 Mips::Mips() {
+  output = NULL;
+  holding = false;
+  calleeSaveOffset = 0;
+  numRegParams = 0;
   mipsName[BinaryOp::Add] = "add";
   mipsName[BinaryOp::Sub] = "sub";
   mipsName[BinaryOp::Mul] = "mul";
@@ -493,51 +654,108 @@ Mips::Mips() {
 }
 const char *Mips::mipsName[BinaryOp::NumOps];
 
-void Mips::AllocateRegisters(List<Location*> *locations) {
-    bool free[NumRegs] = {false, false, false, false, true, true, true, true,
-                                 true, true, true, true, true, true, true, true,
-				 true, true, true, true, true, true, true, true,
-				 true, true, false, false, false, false, false, true};
-    if (locations->NumElements() == 0)
-	return;
-    for (int i = 0; i < locations->NumElements(); ++i) {
-	Location *location = locations->Nth(i);
-	List<Location*> *interferences = location->GetInterferences();
-	if (interferences->NumElements() < NumRegs - 9) {
-	    locations->Remove(location);
-	    for (int j = 0; j < interferences->NumElements(); ++j)
-		interferences->Nth(j)->GetInterferences()->Remove(location);
-	    AllocateRegisters(locations);
-	    for (int j = 0; j < interferences->NumElements(); ++j)
-		if (allocation.count(interferences->Nth(j)))
-		    free[allocation[interferences->Nth(j)]] = false;
-	    int reg = zero;
-	    while (reg < NumRegs && !free[reg])
-		++reg;
-	    //fprintf(stderr, "Allocated %s to %s\n", location->GetName(), regs[reg].name);
-	    allocation[location] = static_cast<Register>(reg);
-	    return;
-	}
-    }
-    Location *spilled = locations->Nth(0);
-    for (int i = 1; i < locations->NumElements(); ++i) {
-	Location *location = locations->Nth(i);
-	if (location->GetScore() < spilled->GetScore())
-	    spilled = location;
-    }
-    //fprintf(stderr, "Spilled %s\n", spilled->GetName());
-    locations->Remove(spilled);
-    for (int j = 0; j < spilled->GetInterferences()->NumElements(); ++j)
-	spilled->GetInterferences()->Nth(j)->GetInterferences()->Remove(spilled);
-    AllocateRegisters(locations);
+const Mips::Register Mips::allocatable[NumAllocatable] = {
+  a0, a1, a2, a3, t0, t1, t2, t3, t4, t5, t6, t7, t8, t9, ra,
+  s0, s1, s2, s3, s4, s5, s6, s7};
+
+/* Method: AllocateRegisters
+ * -------------------------
+ * Assigns registers to the variables of one function by coloring its
+ * interference graph, coalescing copies where that is safe. Any
+ * previous function's assignment is discarded. Variables left without
+ * a register live in their stack slots.
+ */
+void Mips::AllocateRegisters(InterferenceGraph *rig) {
+    allocation.clear();
+    ColoringAllocator colorer(rig, NumAllocatable, FirstCalleeSaved);
+    for (int i = 0; i < rig->NumNodes(); ++i)
+	if (colorer.ColorOf(i) != -1)
+	    allocation[rig->GetLocation(i)] = allocatable[colorer.ColorOf(i)];
+    NoteCalleeSaved();
+}
+
+/* Method: AllocateRegisters
+ * -------------------------
+ * The -O1 version: assigns registers from the live intervals of the
+ * function's variables by linear scan.
+ */
+void Mips::AllocateRegisters(std::vector<LiveInterval> *intervals) {
+    allocation.clear();
+    LinearScanAllocator scan(intervals, NumAllocatable, FirstCalleeSaved);
+    for (int i = 0; i < (int)intervals->size(); ++i)
+	if ((*intervals)[i].color != -1)
+	    allocation[(*intervals)[i].var] = allocatable[(*intervals)[i].color];
+    NoteCalleeSaved();
+}
+
+/* Method: NoteCalleeSaved
+ * -----------------------
+ * Records which callee-saved registers the new allocation uses, so the
+ * prologue and epilogue can save and restore them.
+ */
+void Mips::NoteCalleeSaved() {
+    bool used[NumRegs] = {false};
+    for (std::map<Location*,Register>::iterator it = allocation.begin(); it != allocation.end(); ++it)
+	used[it->second] = true;
+    calleeSaved.clear();
+    for (int reg = s0; reg <= s7; ++reg)
+	if (used[reg])
+	    calleeSaved.push_back(static_cast<Register>(reg));
 }
 
+// Callee-saved registers survive calls, so only the others are saved
 void Mips::SaveCaller(Location *location) {
-    if (allocation.count(location))
+    if (allocation.count(location) && !IsCalleeSaved(allocation[location]))
 	SpillRegister(location, allocation[location]);
 }
 
 void Mips::RestoreCaller(Location *location) {
-    if (allocation.count(location))
+    if (allocation.count(location) && !IsCalleeSaved(allocation[location]))
 	FillRegister(location, allocation[location]);
 }
+
+/* Method: FillOnEntry
+ * -------------------
+ * Puts the formals live on entry to the function where the allocation
+ * wants them. Those passed on the stack are filled into their
+ * registers. Those arriving in $a0-$a3 are first stored to their slots
+ * if they have no register, then moved to their registers as one
+ * parallel copy: a move waits while its destination still holds the
+ * source of another, and a cycle of such moves is broken by parking
+ * one value in $v0.
+ */
+void Mips::FillOnEntry(List<Location*> *formals) {
+    std::vector<std::pair<Register, Register> > moves; // (to, from)
+    for (int i = 0; i < formals->NumElements(); i++) {
+	Location *var = formals->Nth(i);
+	if (var->GetArgRegister() == -1) continue;
+	Register from = static_cast<Register>(a0 + var->GetArgRegister());
+	if (!allocation.count(var))
+	    SpillRegister(var, from);
+	else if (allocation[var] != from)
+	    moves.push_back(std::make_pair(allocation[var], from));
+    }
+    while (!moves.empty()) {
+	int ready = -1;
+	for (int m = 0; m < (int)moves.size() && ready == -1; m++) {
+	    ready = m;
+	    for (int k = 0; k < (int)moves.size(); k++)
+		if (moves[k].second == moves[m].first) ready = -1;
+	}
+	if (ready == -1) { // all in cycles
+	    Register parked = moves[0].first;
+	    Emit("move %s, %s\t\t# park param value", regs[v0].name, regs[parked].name);
+	    for (int k = 0; k < (int)moves.size(); k++)
+		if (moves[k].second == parked) moves[k].second = v0;
+	    ready = 0;
+	}
+	Emit("move %s, %s\t\t# move param value to its register",
+	     regs[moves[ready].first].name, regs[moves[ready].second].name);
+	moves.erase(moves.begin() + ready);
+    }
+    for (int i = 0; i < formals->NumElements(); i++) {
+	Location *var = formals->Nth(i);
+	if (var->GetArgRegister() == -1 && allocation.count(var))
+	    FillRegister(var, allocation[var]);
+    }
+}
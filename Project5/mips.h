@@ -20,8 +20,13 @@
 
 #include "tac.h"
 #include "list.h"
+#include "peephole.h"
 #include <map>
+#include <vector>
+#include <string>
 class Location;
+class InterferenceGraph;
+struct LiveInterval;
 
 
 class Mips {
@@ -40,6 +45,13 @@ class Mips {
 
     Register rs, rt, rd;
     std::map<Location*,Register> allocation;
+    std::string *output;
+
+    // A function's code is held here from its prologue to its end and
+    // goes out once the peephole rules have been over it
+    Peephole peephole;
+    bool holding;
+    void Output(const char *text, int len);
 
     typedef enum { ForRead, ForWrite } Reason;
     
@@ -47,6 +59,25 @@ class Mips {
     void SpillRegister(Location *dst, Register reg);
 
     void EmitCallInstr(Location *dst, const char *fn, bool isL);
+    void EmitPopFrame();
+
+    // How many of $a0-$a3 the call being set up has loaded with its
+    // arguments, so a variable allocated to one of those is read from
+    // its stack slot instead (CallerSave has just stored it there).
+    int numRegParams;
+    Register ReadForCall(Location *var, Register scratch);
+
+    // The registers handed out by the allocator, in order of preference.
+    // The last ones, from FirstCalleeSaved on, are $s0-$s7: a function
+    // using one saves it in its prologue and restores it on return, and
+    // in exchange it needs no saving around calls.
+    static const int NumAllocatable = 23, FirstCalleeSaved = 15;
+    static const Register allocatable[NumAllocatable];
+    static bool IsCalleeSaved(Register reg) { return reg >= s0 && reg <= s7; }
+
+    std::vector<Register> calleeSaved;  // those the current function uses
+    int calleeSaveOffset;               // fp offset of the first one's slot
+    void NoteCalleeSaved();
     
     static const char *mipsName[BinaryOp::NumOps];
     static const char *NameForTac(BinaryOp::OpCode code);
@@ -55,10 +86,15 @@ class Mips {
     
     Mips();
 
-    static void Emit(const char *fmt, ...);
+    void Emit(const char *fmt, ...);
+
+    // Sends the assembly emitted from now on to the end of buf rather
+    // than stdout (NULL goes back to stdout). Lets the -j back end build
+    // the code of several functions at once and print it in order.
+    void SetOutput(std::string *buf) { output = buf; }
     
     void EmitLoadConstant(Location *dst, int val);
-    void EmitLoadStringConstant(Location *dst, const char *str);
+    void EmitLoadStringConstant(Location *dst, const char *label, const char *str);
     void EmitLoadLabel(Location *dst, const char *label);
 
     void EmitLoad(Location *dst, Location *reference, int offset);
@@ -71,24 +107,31 @@ class Mips {
     void EmitLabel(const char *label);
     void EmitGoto(const char *label);
     void EmitIfZ(Location *test, const char*label);
+    void EmitIfCompare(IfCompare::Condition cond, Location *op1, Location *op2,
+                       const char *label);
+    void EmitIfInBounds(Location *index, Location *count, const char *label);
     void EmitReturn(Location *returnVal);
 
     void EmitBeginFunction(int frameSize);
     void EmitEndFunction();
 
     void EmitParam(Location *arg);
+    void EmitRegParam(Location *arg, int n);
     void EmitLCall(Location *result, const char* label);
     void EmitACall(Location *result, Location *fnAddr);
     void EmitCallInstrReturn(Location *result);
+    void EmitTailCall(const char *label, Location *fnAddr, int bytes);
     void EmitPopParams(int bytes);
 
     void EmitVTable(const char *label, List<const char*> *methodLabels);
 
     void EmitPreamble();
 
-    void AllocateRegisters(List<Location*> *locations);
+    void AllocateRegisters(InterferenceGraph *rig);
+    void AllocateRegisters(std::vector<LiveInterval> *intervals);
     void SaveCaller(Location *location);
     void RestoreCaller(Location *location);
+    void FillOnEntry(List<Location*> *formals);
 };
 
 
@@ -0,0 +1,49 @@
+/* File: optimize.cc
+ * -----------------
+ * The optimization driver and what the passes share.
+ */
+
+#include "optimize.h"
+#include "cfg.h"
+#include "tac.h"
+
+
+/* Function: OptimizeFunction
+ * --------------------------
+ * Folding goes first, as it settles the branches. Value numbering
+ * turns recomputations into copies, and what a loop still computes
+ * the same way on every trip is then moved out of it. Propagating
+ * copies leaves most of the copies unread, and makes the subscripts of
+ * one array with one index test the same variables, so that bounds
+ * checks can be matched up. Removing dead code, which runs to its own
+ * fixpoint, takes the unread copies and whatever only fed them or the
+ * checks that went.
+ */
+void OptimizeFunction(List<Instruction*> *tac)
+{
+    FoldConstants(tac);
+    NumberValues(tac);
+    HoistInvariants(tac);
+    PropagateCopies(tac);
+    RemoveBoundsChecks(tac);
+    RemoveDeadCode(tac);
+}
+
+void Relayout(FlowGraph *graph, List<Instruction*> *tac)
+{
+    tac-> Clear();
+    for (int b = 0; b < graph-> NumBlocks(); b++) {
+        BasicBlock *block = graph-> Block(b);
+        if (block-> code.NumElements() == 0) continue;     // a pass took all of it
+        if (block-> IsReachable()) {
+            int last = tac-> NumElements() - 1;
+            Label *label = dynamic_cast<Label*> (block-> First());
+            Goto *jump = (last >= 0) ? dynamic_cast<Goto*> (tac-> Nth(last)) : NULL;
+            if (label && jump && jump-> GetLabel() == label-> GetLabel())
+                tac-> RemoveAt(last);
+            for (int i = 0; i < block-> code.NumElements(); i++)
+                tac-> Append(block-> code.Nth(i));
+        } else if (dynamic_cast<EndFunc*> (block-> Last()))
+            tac-> Append(block-> Last());
+    }
+}
@@ -0,0 +1,140 @@
+/* File: optimize.h
+ * ----------------
+ * Machine-independent optimizations over the TAC of one function, run
+ * by the back end at -O2 before it divides the function into blocks for
+ * register allocation. Each pass is handed the function's TAC, from its
+ * BeginFunc to its EndFunc, rewrites it in place and returns true if it
+ * changed anything. The TAC it drops is simply left in the arena.
+ *
+ * Only variables in the stack frame (locals, temps and formals) are
+ * ever assumed to hold a known value: globals can be changed by any
+ * call, and everything else is reached through Load and Store.
+ *
+ * Inlining works across functions, so it runs once over the whole
+ * program first.
+ */
+
+#ifndef _H_optimize
+#define _H_optimize
+
+#include "list.h"
+#include <utility>
+
+class Instruction;
+class FlowGraph;
+
+
+/* Function: InlineCalls()
+ * Usage: InlineCalls(code, functions);
+ * ------------------------------------
+ * Replaces calls to small Decaf functions and methods (called by label,
+ * which includes the devirtualized ones) with copies of their bodies,
+ * whose variables get slots of their own in the caller's frame.
+ * Functions that call others are only inlined once their own calls
+ * have been. functions holds the position of each function's BeginFunc
+ * and EndFunc in code, and is updated to match.
+ */
+void InlineCalls(List<Instruction*> *code, List<std::pair<int, int> > *functions);
+
+
+/* Function: EliminateTailCalls()
+ * Usage: changed = EliminateTailCalls(&tac, label);
+ * -------------------------------------------------
+ * Tail-call elimination, which the back end does at every level, for
+ * the stack it saves: a call whose result the function returns, or
+ * that it ends with, becomes a jump back to the start when the function
+ * (whose label is self) calls itself, and otherwise a TailCall that
+ * reuses its place on the stack where there is room.
+ */
+bool EliminateTailCalls(List<Instruction*> *tac, const char *self);
+
+
+/* Function: OptimizeFunction()
+ * Usage: OptimizeFunction(&tac);
+ * ------------------------------
+ * Runs all the passes over the function in tac.
+ */
+void OptimizeFunction(List<Instruction*> *tac);
+
+
+/* Function: FoldConstants()
+ * Usage: changed = FoldConstants(&tac);
+ * -------------------------------------
+ * Constant folding and propagation: an operation whose operands are
+ * known constants is replaced by a LoadConstant of its result, an IfZ
+ * or IfCompare on known constants becomes a Goto or disappears, code
+ * that can no longer be reached goes, and so do LoadConstants nothing
+ * reads.
+ */
+bool FoldConstants(List<Instruction*> *tac);
+
+
+/* Function: NumberValues()
+ * Usage: changed = NumberValues(&tac);
+ * ------------------------------------
+ * Value numbering over extended basic blocks (a block and the blocks
+ * below it that have no other way in): an operation, constant, label
+ * or load repeating one whose result is still in a frame variable
+ * becomes a copy of that variable. Stores and calls end the reuse of
+ * loads and of globals' values.
+ */
+bool NumberValues(List<Instruction*> *tac);
+
+
+/* Function: HoistInvariants()
+ * Usage: changed = HoistInvariants(&tac);
+ * ---------------------------------------
+ * Loop-invariant code motion: finds the natural loops of the function
+ * and moves the pure computations whose operands do not change inside
+ * a loop to a preheader, where they run once on the way in. Only loops
+ * entered by falling into their header, as the front end lays them
+ * out, have a preheader to move to.
+ */
+bool HoistInvariants(List<Instruction*> *tac);
+
+
+/* Function: PropagateCopies()
+ * Usage: changed = PropagateCopies(&tac);
+ * ---------------------------------------
+ * Copy propagation: a use of a variable last written by a copy reads
+ * the copy's source instead, wherever the source is certain to be
+ * unchanged since.
+ */
+bool PropagateCopies(List<Instruction*> *tac);
+
+
+/* Function: RemoveBoundsChecks()
+ * Usage: changed = RemoveBoundsChecks(&tac);
+ * ------------------------------------------
+ * Bounds-check elimination: an array subscript's IfInBounds goes when
+ * the same index is already known to be within the same count, by an
+ * earlier check on every path to it or by the test of the loop it is
+ * in (i < arr.length() with i never negative).
+ */
+bool RemoveBoundsChecks(List<Instruction*> *tac);
+
+
+/* Function: RemoveDeadCode()
+ * Usage: changed = RemoveDeadCode(&tac);
+ * --------------------------------------
+ * Dead code elimination by liveness: removes the TACs that only
+ * compute a value into a frame variable that is never read afterwards.
+ * Calls, stores, and arithmetic that can trap (add, sub, div, rem)
+ * stay.
+ */
+bool RemoveDeadCode(List<Instruction*> *tac);
+
+
+/* Function: Relayout()
+ * Usage: Relayout(&graph, &tac);
+ * ------------------------------
+ * Replaces tac with the code of the graph's blocks, in layout order,
+ * leaving out the blocks that cannot be reached (but never the
+ * EndFunc) and any Goto that that leaves just before its label. A
+ * block a pass has emptied altogether simply falls through.
+ * Passes that rewrite the blocks' code lists use this to put the
+ * function back together.
+ */
+void Relayout(FlowGraph *graph, List<Instruction*> *tac);
+
+#endif
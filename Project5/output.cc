@@ -0,0 +1,72 @@
+/* File: output.cc
+ * ---------------
+ * Implementation of the OutputSink class.
+ */
+
+#include "output.h"
+#include "utility.h"
+#include <stdarg.h>
+
+
+OutputSink::OutputSink(FILE *f, size_t cap) : file(f), used(0), capacity(cap)
+{
+    buffer = (char*)malloc(capacity);
+    if (!buffer) Failure("Out of memory!");
+}
+
+OutputSink::~OutputSink()
+{
+    Flush();
+    free(buffer);
+}
+
+void OutputSink::Printf(const char *format, ...)
+{
+    va_list args;
+    char buf[1024];
+
+    va_start(args, format);
+    int length = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (length >= (int)sizeof(buf)) length = sizeof(buf) - 1;
+    Append(buf, length);
+}
+
+void OutputSink::Flush()
+{
+    if (used > 0 && fwrite(buffer, 1, used, file) != used)
+        Failure("Error writing output");
+    used = 0;
+    fflush(file);
+}
+
+/* Method: WriteThrough
+ * --------------------
+ * Called when text doesn't fit in what is left of the buffer. Writes
+ * the buffer out, then buffers text, or if it is bigger than the whole
+ * buffer (a -j function's code can be), writes it directly.
+ */
+void OutputSink::WriteThrough(const char *text, size_t length)
+{
+    Flush();
+    if (length > capacity) {
+        if (fwrite(text, 1, length, file) != length)
+            Failure("Error writing output");
+    } else {
+        memcpy(buffer, text, length);
+        used = length;
+    }
+}
+
+
+OutputSink *AsmOutput()
+{
+    static OutputSink *sink = NULL;
+    if (sink == NULL) {
+        FILE *file = stdout;
+        if (OutputFileName() && (file = fopen(OutputFileName(), "w")) == NULL)
+            Failure("Cannot open %s for writing", OutputFileName());
+        sink = new OutputSink(file);
+    }
+    return sink;
+}
@@ -0,0 +1,56 @@
+/* File: output.h
+ * --------------
+ * The OutputSink class collects text in a large buffer and writes it
+ * to a file a buffer at a time, so producing the assembly costs a
+ * memcpy per line rather than a handful of stdio calls. AsmOutput()
+ * is the sink all of the compiler's output goes through: the emitted
+ * assembly, the runtime appended after it and the TAC listing printed
+ * for -d tac. It writes to stdout, or to the file given with -o.
+ */
+
+#ifndef _H_output
+#define _H_output
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+
+class OutputSink {
+  private:
+    FILE *file;
+    char *buffer;
+    size_t used, capacity;
+
+  public:
+          // Buffers up to capacity bytes at a time on their way to file
+    OutputSink(FILE *file, size_t capacity = 1 << 20);
+    ~OutputSink();
+
+    void Append(const char *text, size_t length)
+        { if (used + length > capacity) { WriteThrough(text, length); return; }
+          memcpy(buffer + used, text, length); used += length; }
+    void Append(const char *text)           { Append(text, strlen(text)); }
+    void Append(const std::string &text)    { Append(text.data(), text.size()); }
+
+          // Appends printf-style formatted text
+    void Printf(const char *format, ...);
+
+          // Writes out whatever is buffered
+    void Flush();
+
+  private:
+    void WriteThrough(const char *text, size_t length);
+};
+
+
+/* Function: AsmOutput()
+ * Usage: AsmOutput()->Append(line);
+ * ---------------------------------
+ * Returns the sink for the compiler's output, opening the -o file the
+ * first time if one was given. Only the main thread writes to it; the
+ * -j back end's workers build their functions' code in strings first.
+ */
+OutputSink *AsmOutput();
+
+#endif
@@ -11,6 +11,12 @@
 
 void yyerror(const char *msg); // standard error-handling routine
 
+// Lists of children are allocated in the AST arena, like the nodes
+template <class Element> static List<Element> *NewList()
+{
+    return new (AstArena()) List<Element>(AstArena());
+}
+
 %}
 
  
@@ -22,7 +28,7 @@ void yyerror(const char *msg); // standard error-handling routine
     bool boolConstant;
     char *stringConstant;
     double doubleConstant;
-    char identifier[MaxIdentLen+1]; // +1 for terminating null
+    const char *identifier;         // interned, see intern.h
     Decl *decl;
     List<Decl*> *declList;
     Type *type;
@@ -108,7 +114,7 @@ Program   :    DeclList            {
 
 
 DeclList  :    DeclList Decl        { ($$=$1)->Append($2); }
-          |    Decl                 { ($$ = new List<Decl*>)->Append($1); }
+          |    Decl                 { ($$ = NewList<Decl*>())->Append($1); }
           ;
 
 Decl      :    ClassDecl
@@ -139,7 +145,7 @@ IntfDecl  :    T_Interface T_Identifier '{' IntfList '}'
 
 IntfList  :    IntfList FnHeader ';'
                                     { ($$=$1)->Append($2); }
-          |    /* empty */          { $$ = new List<Decl*>(); }
+          |    /* empty */          { $$ = NewList<Decl*>(); }
           ;
 
 ClassDecl :    T_Class T_Identifier OptExt OptImpl '{' FieldList '}'
@@ -153,16 +159,16 @@ OptExt    :    T_Extends T_Identifier
 
 OptImpl   :    T_Implements ImpList 
                                     { $$ = $2; }
-          |    /* empty */          { $$ = new List<NamedType*>; }
+          |    /* empty */          { $$ = NewList<NamedType*>(); }
           ;
 
 ImpList   :    ImpList ',' T_Identifier    
                                     { ($$=$1)->Append(new NamedType(new Identifier(@3, $3))); }
-          |    T_Identifier         { ($$=new List<NamedType*>)->Append(new NamedType(new Identifier(@1, $1))); }
+          |    T_Identifier         { ($$=NewList<NamedType*>())->Append(new NamedType(new Identifier(@1, $1))); }
           ;
 
 FieldList :    FieldList Field      { ($$=$1)->Append($2); }
-          |    /* empty */          { $$ = new List<Decl*>(); }
+          |    /* empty */          { $$ = NewList<Decl*>(); }
           ;
 
 Field     :    VarDecl              { $$ = $1; }
@@ -177,12 +183,12 @@ FnHeader  :    Type T_Identifier '(' Formals ')'
           ;
 
 Formals   :    FormalList           { $$ = $1; }
-          |    /* empty */          { $$ = new List<VarDecl*>; }
+          |    /* empty */          { $$ = NewList<VarDecl*>(); }
           ;
 
 FormalList:    FormalList ',' Variable  
                                     { ($$=$1)->Append($3); }
-          |    Variable             { ($$ = new List<VarDecl*>)->Append($1); }
+          |    Variable             { ($$ = NewList<VarDecl*>())->Append($1); }
           ;
 
 FnDecl    :    FnHeader StmtBlock   { ($$=$1)->SetFunctionBody($2); }
@@ -193,11 +199,11 @@ StmtBlock :    '{' VarDecls StmtList '}'
           ;
 
 VarDecls  :    VarDecls VarDecl     { ($$=$1)->Append($2); }
-          |    /* empty */          { $$ = new List<VarDecl*>; }
+          |    /* empty */          { $$ = NewList<VarDecl*>(); }
           ;
 
 StmtList  :    Stmt StmtList        { $$ = $2; $$->InsertAt($1, 0); }
-          |    /* empty */          { $$ = new List<Stmt*>; }
+          |    /* empty */          { $$ = NewList<Stmt*>(); }
           ;
 
 Stmt      :    OptExpr ';'          { $$ = $1; }
@@ -276,11 +282,11 @@ Constant  :    T_IntConstant        { $$ = new IntConstant(@1,$1); }
           ;
 
 Actuals   :    ExprList             { $$ = $1; }
-          |    /* empty */          { $$ = new List<Expr*>; }
+          |    /* empty */          { $$ = NewList<Expr*>(); }
           ;
 
 ExprList  :    ExprList ',' Expr    { ($$=$1)->Append($3); }
-          |    Expr                 { ($$ = new List<Expr*>)->Append($1); }
+          |    Expr                 { ($$ = NewList<Expr*>())->Append($1); }
           ;
 
 OptElse   :    T_Else Stmt          { $$ = $2; }
@@ -0,0 +1,277 @@
+/* File: peephole.cc
+ * -----------------
+ * Implementation of the peephole pass over one function's assembly.
+ */
+
+#include "peephole.h"
+#include <atomic>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef Peephole::Line Line;
+
+
+/* Method: Parse
+ * -------------
+ * Splits an instruction line into its op and up to three operands,
+ * leaving out the comment. A label's name goes in args[0]. Comments,
+ * directives and the string constants put in the data segment get
+ * neither, and the rules pass over them.
+ */
+void Peephole::Line::Parse()
+{
+    op.clear();
+    numArgs = 0;
+    isLabel = false;
+    const char *p = text.c_str() + strspn(text.c_str(), " \t");
+    size_t len = strcspn(p, "#\n");
+    while (len > 0 && isspace(p[len - 1])) len--;
+    if (len == 0 || *p == '.') return;
+    if (p[len - 1] == ':' && !memchr(p, ' ', len)) {
+        isLabel = true;
+        args[0].assign(p, len - 1);
+        return;
+    }
+    size_t opLen = strcspn(p, " \t");
+    if (opLen > len) opLen = len;
+    if (p[opLen - 1] == ':') return;        // a string constant's label and .asciiz
+    op.assign(p, opLen);
+    for (size_t i = opLen; i < len && numArgs < 3; ) {
+        i += strspn(p + i, " \t,");
+        size_t argLen = strcspn(p + i, ",");
+        if (i + argLen > len) argLen = len - i;
+        while (argLen > 0 && isspace(p[i + argLen - 1])) argLen--;
+        if (argLen > 0) args[numArgs++].assign(p + i, argLen);
+        i += argLen + 1;
+    }
+}
+
+
+static bool IsBranch(const std::string &op)
+{
+    static const char *branches[] = { "b", "j", "beqz", "bnez", "beq", "bne", "blt", "bge",
+                                      "bgt", "ble", "bltu", "bgeu", "bgtu", "bleu" };
+    for (int i = 0; i < (int)(sizeof(branches)/sizeof(branches[0])); i++)
+        if (op == branches[i]) return true;
+    return false;
+}
+
+/* Function: Dest
+ * --------------
+ * Returns the register line writes, or "" for those that only read
+ * their operands (stores, branches, jumps).
+ */
+static std::string Dest(const Line &line)
+{
+    if (line.numArgs == 0 || line.op == "sw" || line.op == "sb" || IsBranch(line.op) ||
+        line.op == "jr" || line.op == "jal" || line.op == "jalr")
+        return "";
+    return line.args[0];
+}
+
+/* Function: Reads
+ * ---------------
+ * Returns how many of line's operands read reg, counting the base
+ * register of a memory operand.
+ */
+static int Reads(const Line &line, const std::string &reg)
+{
+    int count = 0;
+    for (int a = Dest(line).empty() ? 0 : 1; a < line.numArgs; a++) {
+        const std::string &arg = line.args[a];
+        size_t paren = arg.find('(');
+        if (paren != std::string::npos)
+            count += (arg.compare(paren + 1, arg.size() - paren - 2, reg) == 0);
+        else
+            count += (arg == reg);
+    }
+    return count;
+}
+
+  // The index of the next instruction or label after i, or -1
+static int Next(const std::vector<Line> &lines, int i)
+{
+    for (i++; i < (int)lines.size(); i++)
+        if (!lines[i].removed && (lines[i].isLabel || !lines[i].op.empty())) return i;
+    return -1;
+}
+
+/* Function: IsDeadAfter
+ * ---------------------
+ * Returns true if the value in reg after line i is certainly never
+ * read: looking ahead in a straight line, reg is written before it is
+ * read, or the function returns (only $v0 and the registers a caller
+ * keeps count then), or a call clobbers it. A jr to anywhere but $ra is
+ * a tail call, so $a0-$a3 may still be read. A label or branch on the
+ * way, or a long stretch, ends the search with the answer no.
+ */
+static bool IsDeadAfter(const std::vector<Line> &lines, int i, const std::string &reg)
+{
+    bool scratch = (reg[1] == 't' || reg[1] == 'a' || reg == "$v1");
+    int steps = 0;
+    for (int k = Next(lines, i); k != -1 && steps < 32; k = Next(lines, k), steps++) {
+        const Line &line = lines[k];
+        if (line.isLabel || IsBranch(line.op)) return false;
+        if (line.op == "jr")
+            return scratch && !Reads(line, reg) && (line.args[0] == "$ra" || reg[1] != 'a');
+        if (line.op == "jal" || line.op == "jalr") {
+            if (Reads(line, reg) || reg[1] == 'a') return false;   // may be an argument
+            if (scratch || reg[1] == 'v') return true;
+            continue;
+        }
+        if (Reads(line, reg)) return false;
+        if (Dest(line) == reg) return true;
+    }
+    return false;
+}
+
+static void Rewrite(Line *line, const std::string &instr)
+{
+    line-> text = "\t  " + instr + "\n";
+    line-> Parse();
+}
+
+static bool Fits(long value, long low, long high) { return value >= low && value <= high; }
+
+
+/* Function: StoreThenLoad
+ * -----------------------
+ * sw $r, X followed by lw $r, X: the register already holds it.
+ */
+static int StoreThenLoad(std::vector<Line> &lines, int i)
+{
+    int j = Next(lines, i);
+    if (lines[i].op != "sw" || j == -1 || lines[j].op != "lw") return 0;
+    if (lines[j].args[0] != lines[i].args[0] || lines[j].args[1] != lines[i].args[1]) return 0;
+    lines[j].removed = true;
+    return 1;
+}
+
+/* Function: SelfMove
+ * ------------------
+ * move $r, $r does nothing.
+ */
+static int SelfMove(std::vector<Line> &lines, int i)
+{
+    if (lines[i].op != "move" || lines[i].args[0] != lines[i].args[1]) return 0;
+    lines[i].removed = true;
+    return 1;
+}
+
+/* Function: FoldConstant
+ * ----------------------
+ * li $r, n whose value is read once, by the next instruction, and then
+ * dead: a move of it becomes an li straight into the destination, and
+ * an add, sub, slt, and or or with an immediate form takes n as its
+ * immediate (16 bits, zero-extended for and/or).
+ */
+static int FoldConstant(std::vector<Line> &lines, int i)
+{
+    int j = Next(lines, i);
+    if (lines[i].op != "li" || j == -1 || lines[j].isLabel) return 0;
+    const Line &use = lines[j];
+    const std::string &reg = lines[i].args[0], &imm = lines[i].args[1];
+    if (Reads(use, reg) != 1) return 0;
+
+    long n = strtol(imm.c_str(), NULL, 10);
+    std::string folded, dst = use.args[0];
+    if (use.op == "move") {
+        folded = "li " + dst + ", " + imm;
+    } else if (use.numArgs == 3) {
+        bool second = (use.args[2] == reg);
+        const std::string &other = second ? use.args[1] : use.args[2];
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%ld", -n);
+        if (use.op == "add" && Fits(n, -32768, 32767))
+            folded = "addi " + dst + ", " + other + ", " + imm;
+        else if (use.op == "sub" && second && Fits(-n, -32768, 32767))
+            folded = "addi " + dst + ", " + other + ", " + buf;
+        else if (use.op == "slt" && second && Fits(n, -32768, 32767))
+            folded = "slti " + dst + ", " + other + ", " + imm;
+        else if ((use.op == "and" || use.op == "or") && Fits(n, 0, 65535))
+            folded = use.op + "i " + dst + ", " + other + ", " + imm;
+    }
+    if (folded.empty() || (dst != reg && !IsDeadAfter(lines, j, reg))) return 0;
+    Rewrite(&lines[j], folded);
+    lines[i].removed = true;
+    return 1;
+}
+
+/* Function: BranchToNext
+ * ----------------------
+ * A branch, taken or not, to one of the labels right after it.
+ */
+static int BranchToNext(std::vector<Line> &lines, int i)
+{
+    if (!IsBranch(lines[i].op)) return 0;
+    const std::string &target = lines[i].args[lines[i].numArgs - 1];
+    for (int k = Next(lines, i); k != -1 && lines[k].isLabel; k = Next(lines, k)) {
+        if (lines[k].args[0] == target) {
+            lines[i].removed = true;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+static struct Rule {
+    const char *name;
+    int (*apply)(std::vector<Line> &lines, int i);
+    std::atomic<int> removed;           // over the whole compilation
+} rules[] = {
+    { "store-load", StoreThenLoad, {0} },
+    { "self-move", SelfMove, {0} },
+    { "fold-li", FoldConstant, {0} },
+    { "branch-next", BranchToNext, {0} },
+};
+static const int NumRules = sizeof(rules)/sizeof(rules[0]);
+
+
+void Peephole::Append(const char *text, int len)
+{
+    lines.push_back(Line());
+    lines.back().text.assign(text, len);
+    lines.back().removed = false;
+    lines.back().Parse();
+}
+
+/* Method: Optimize
+ * ----------------
+ * Tries every rule at every instruction, and goes round again while
+ * any of them fires, since one change can set up another.
+ */
+void Peephole::Optimize()
+{
+    for (bool changed = true; changed; ) {
+        changed = false;
+        for (int i = 0; i < (int)lines.size(); i++) {
+            for (int r = 0; r < NumRules && !lines[i].removed && !lines[i].op.empty(); r++) {
+                if (int removed = rules[r].apply(lines, i)) {
+                    rules[r].removed += removed;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+void Peephole::Flush(std::string *out)
+{
+    Optimize();
+    for (int i = 0; i < (int)lines.size(); i++)
+        if (!lines[i].removed) out-> append(lines[i].text);
+    lines.clear();
+}
+
+void Peephole::PrintStats()
+{
+    int total = 0;
+    for (int r = 0; r < NumRules; r++) {
+        fprintf(stderr, "peephole: %-12s %6d removed\n", rules[r].name, (int)rules[r].removed);
+        total += rules[r].removed;
+    }
+    fprintf(stderr, "peephole: %-12s %6d removed\n", "total", total);
+}
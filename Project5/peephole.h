@@ -0,0 +1,49 @@
+/* File: peephole.h
+ * ----------------
+ * The Peephole class holds on to the assembly of one function as Mips
+ * emits it and, once the function is done, cleans it up with a table
+ * of rules before passing it on. Each rule looks at an instruction and
+ * the one after it (comments in between don't count, labels do) and
+ * removes or rewrites what the one-TAC-at-a-time translation left
+ * redundant: a load of what was just stored, a move to itself, a
+ * constant loaded into a register only to be used once, a branch to
+ * the very next line.
+ *
+ * What each rule removed is added up over the whole compilation, and
+ * PrintStats reports it (see -d peephole).
+ */
+
+#ifndef _H_peephole
+#define _H_peephole
+
+#include <string>
+#include <vector>
+
+class Peephole {
+  public:
+    struct Line {
+        std::string text;                   // as emitted, newline and all
+        std::string op, args[3];            // op is empty if not an instruction
+        int numArgs;
+        bool isLabel, removed;
+
+        void Parse();
+    };
+
+  private:
+    std::vector<Line> lines;
+
+    void Optimize();
+
+  public:
+          // Adds one line of assembly to the function being held
+    void Append(const char *text, int len);
+
+          // Runs the rules over the lines held, appends the result to
+          // out and starts over empty
+    void Flush(std::string *out);
+
+    static void PrintStats();
+};
+
+#endif
@@ -0,0 +1,105 @@
+/* File: reaching.cc
+ * -----------------
+ * Implementation of reaching definitions over basic blocks.
+ */
+
+#include "reaching.h"
+#include "cfg.h"
+#include "tac.h"
+
+
+/* Method: ReachingDefs
+ * --------------------
+ * Variables are numbered in order of first mention. The definitions of
+ * each variable are numbered together, its entry definition first and
+ * then the TACs writing it in layout order, so that killing them all
+ * is clearing a run of bits. Reaching definitions is then a forward
+ * bit-vector problem over the blocks: a block's gen is the definitions
+ * in it that are not overwritten before its end, its kill every
+ * definition of a variable it writes. The entry definitions are
+ * generated by the entry block, which nothing branches back to.
+ */
+ReachingDefs::ReachingDefs(FlowGraph *graph)
+{
+    std::vector<int> numDefs;
+    for (int b = 0; b < graph-> NumBlocks(); b++) {
+        List<Instruction*> *tacs = &graph-> Block(b)-> code;
+        for (int i = 0; i < tacs-> NumElements(); i++) {
+            Location *gen[Instruction::MaxGen], *kill = tacs-> Nth(i)-> GetKill();
+            int numGen = tacs-> Nth(i)-> GetGen(gen);
+            for (int j = -1; j < numGen; j++) {
+                Location *var = (j == -1) ? kill : gen[j];
+                if (var && varIndex.insert(std::make_pair(var, (int)vars.size())).second) {
+                    vars.push_back(var);
+                    numDefs.push_back(1);
+                }
+            }
+            if (kill) numDefs[varIndex[kill]]++;
+        }
+    }
+
+    firstDef.resize(vars.size() + 1);
+    firstDef[0] = 0;
+    for (int v = 0; v < (int)vars.size(); v++)
+        firstDef[v + 1] = firstDef[v] + numDefs[v];
+    defs.resize(firstDef.back());
+    entryIn.Resize(defs.size());
+    for (int v = 0; v < (int)vars.size(); v++) {
+        numDefs[v] = 1;          // now the number given out so far
+        entryIn.Set(firstDef[v]);
+    }
+    for (int b = 0; b < graph-> NumBlocks(); b++) {
+        List<Instruction*> *tacs = &graph-> Block(b)-> code;
+        for (int i = 0; i < tacs-> NumElements(); i++) {
+            if (Location *kill = tacs-> Nth(i)-> GetKill()) {
+                int v = varIndex[kill], d = firstDef[v] + numDefs[v]++;
+                defs[d] = tacs-> Nth(i);
+                defIndex[tacs-> Nth(i)] = d;
+            }
+        }
+    }
+
+    solution = new Dataflow(graph-> NumBlocks(), defs.size(), Dataflow::Forward);
+    for (int b = 0; b < graph-> NumBlocks(); b++) {
+        BasicBlock *block = graph-> Block(b);
+        for (int j = 0; j < block-> succs.NumElements(); j++)
+            solution-> AddEdge(b, block-> succs.Nth(j)-> id);
+        BitVector *blockGen = solution-> Gen(b), *blockKill = solution-> Kill(b);
+        if (block == graph-> Entry())
+            *blockGen = entryIn;
+        for (int i = 0; i < block-> code.NumElements(); i++) {
+            StepForward(block-> code.Nth(i), blockGen);
+            if (Location *kill = block-> code.Nth(i)-> GetKill()) {
+                int v = varIndex[kill];
+                for (int d = firstDef[v]; d < firstDef[v + 1]; d++)
+                    blockKill-> Set(d);
+            }
+        }
+    }
+    solution-> Solve();
+}
+
+ReachingDefs::~ReachingDefs()
+{
+    delete solution;
+}
+
+int ReachingDefs::IndexOf(Location *var) const
+{
+    std::unordered_map<Location*, int>::const_iterator found = varIndex.find(var);
+    return found == varIndex.end() ? -1 : found-> second;
+}
+
+const BitVector &ReachingDefs::In(BasicBlock *block) const
+{
+    return block-> id == 0 ? entryIn : solution-> In(block-> id);
+}
+
+void ReachingDefs::StepForward(Instruction *tac, BitVector *reaching) const
+{
+    Location *kill = tac-> GetKill();
+    if (!kill) return;
+    int v = IndexOf(kill);
+    reaching-> ResetRange(firstDef[v], firstDef[v + 1]);
+    reaching-> Set(defIndex.find(tac)-> second);
+}
@@ -0,0 +1,70 @@
+/* File: reaching.h
+ * ----------------
+ * The ReachingDefs class solves reaching definitions for one function's
+ * FlowGraph: which of the TACs writing a variable may have been the
+ * last to write it when control gets to a given point. Every TAC with a
+ * kill is a definition, and each variable also has one made-up
+ * definition standing for whatever value it has on entry to the
+ * function (a formal's argument, a global, or garbage), so a use that
+ * may see such a value finds that out instead of seeing nothing.
+ *
+ * Sets inside a block are recovered by walking it forwards from its
+ * reaching-in set with StepForward:
+ *
+ *       BitVector defs = reaching.In(block);
+ *       for (int i = 0; i < block->code.NumElements(); i++) {
+ *           ... defs is what reaches block->code.Nth(i) ...
+ *           reaching.StepForward(block->code.Nth(i), &defs);
+ *       }
+ */
+
+#ifndef _H_reaching
+#define _H_reaching
+
+#include <vector>
+#include <unordered_map>
+#include "bitvector.h"
+#include "dataflow.h"
+
+class FlowGraph;
+class BasicBlock;
+class Instruction;
+class Location;
+
+class ReachingDefs {
+  private:
+    std::vector<Location*> vars;
+    std::unordered_map<Location*, int> varIndex;
+    std::vector<int> firstDef;              // of each variable, and one past the last
+    std::vector<Instruction*> defs;         // NULL for the entry definitions
+    std::unordered_map<Instruction*, int> defIndex;
+    BitVector entryIn;                      // the entry definitions
+    Dataflow *solution;
+
+  public:
+          // Numbers the definitions of the graph and solves for it
+    ReachingDefs(FlowGraph *graph);
+    ~ReachingDefs();
+
+    int NumVars() const                     { return vars.size(); }
+    Location *Var(int v) const              { return vars[v]; }
+
+          // Returns the number of a variable, or -1 if the function never
+          // mentions it
+    int IndexOf(Location *var) const;
+
+          // The definitions of variable v are numbered consecutively
+          // from FirstDef(v) up to (not including) EndDef(v). The first
+          // is its entry definition, whose Def is NULL.
+    int FirstDef(int v) const               { return firstDef[v]; }
+    int EndDef(int v) const                 { return firstDef[v + 1]; }
+    Instruction *Def(int d) const           { return defs[d]; }
+
+    const BitVector &In(BasicBlock *block) const;
+
+          // Turns the set reaching tac into the set reaching the TAC
+          // after it
+    void StepForward(Instruction *tac, BitVector *reaching) const;
+};
+
+#endif
@@ -0,0 +1,344 @@
+/* File: regalloc.cc
+ * -----------------
+ * Implementation of the register allocators. The structure and names of
+ * iterated register coalescing follow the presentation in Appel's
+ * "Modern Compiler Implementation", less the handling of precolored
+ * nodes, which this code generator does not have.
+ */
+
+#include "regalloc.h"
+#include "interference.h"
+#include <algorithm>
+
+
+/* Function: PickColor
+ * -------------------
+ * Returns the first color not marked used, or -1 if there is none.
+ * Callee-saved colors are tried first for values that cross more than
+ * one call and last for everything else.
+ */
+static int PickColor(const std::vector<char> &used, int numColors, int firstCalleeSaved,
+                     int callsCrossed)
+{
+    for (int i = 0; i < numColors; i++) {
+        int c = (callsCrossed > 1) ? (i + firstCalleeSaved) % numColors : i;
+        if (!used[c]) return c;
+    }
+    return -1;
+}
+
+
+ColoringAllocator::ColoringAllocator(InterferenceGraph *g, int k, int calleeSaved) :
+    rig(g), numColors(k), firstCalleeSaved(calleeSaved), numCoalesced(0), markStamp(0)
+{
+    int numNodes = rig-> NumNodes();
+    state.assign(numNodes, ToSimplify);
+    degree.resize(numNodes);
+    alias.resize(numNodes);
+    color.assign(numNodes, -1);
+    moveList.resize(numNodes);
+    mark.assign(numNodes, 0);
+    moveState.assign(rig-> NumMoves(), Worklist);
+    for (int m = 0; m < rig-> NumMoves(); m++) {
+        moveList[rig-> Move(m).first].push_back(m);
+        moveList[rig-> Move(m).second].push_back(m);
+        worklistMoves.push_back(m);
+    }
+
+    for (int n = 0; n < numNodes; n++) {
+        degree[n] = rig-> Degree(n);
+        alias[n] = n;
+        if (degree[n] >= numColors)
+            SetState(n, ToSpill);
+        else if (MoveRelated(n))
+            SetState(n, ToFreeze);
+        else
+            SetState(n, ToSimplify);
+    }
+
+    while (true) {
+        if (!simplifyList.empty()) {
+            int n = simplifyList.back();
+            simplifyList.pop_back();
+            if (state[n] == ToSimplify) Simplify(n);
+        } else if (!worklistMoves.empty()) {
+            int m = worklistMoves.back();
+            worklistMoves.pop_back();
+            if (moveState[m] == Worklist) Coalesce(m);
+        } else if (!freezeList.empty()) {
+            int n = freezeList.back();
+            freezeList.pop_back();
+            if (state[n] == ToFreeze) {
+                SetState(n, ToSimplify);
+                FreezeMoves(n);
+            }
+        } else if (!spillList.empty()) {
+            SelectSpill();
+        } else
+            break;
+    }
+    AssignColors();
+}
+
+
+/* Method: SetState
+ * ----------------
+ * Moves a node into a new state, adding it to the worklist for that
+ * state. Whatever list it was on before still holds it, but the entry
+ * is now stale and will be skipped.
+ */
+void ColoringAllocator::SetState(int n, NodeState s)
+{
+    state[n] = s;
+    if (s == ToSimplify) simplifyList.push_back(n);
+    else if (s == ToFreeze) freezeList.push_back(n);
+    else if (s == ToSpill) spillList.push_back(n);
+}
+
+bool ColoringAllocator::MoveRelated(int n)
+{
+    for (int i = 0; i < (int)moveList[n].size(); i++)
+        if (IsPending(moveList[n][i])) return true;
+    return false;
+}
+
+int ColoringAllocator::GetAlias(int n)
+{
+    while (state[n] == Coalesced)
+        n = alias[n];
+    return n;
+}
+
+void ColoringAllocator::AddEdge(int u, int v)
+{
+    if (rig-> AddEdge(u, v)) {
+        degree[u]++;
+        degree[v]++;
+    }
+}
+
+/* Method: DecrementDegree
+ * -----------------------
+ * Called when a neighbor of n leaves the graph. When n drops below
+ * numColors neighbors it is no longer a spill candidate, and moves
+ * that were put aside because of it (or its neighbors) may now pass
+ * the coalescing test, so they are retried.
+ */
+void ColoringAllocator::DecrementDegree(int n)
+{
+    if (degree[n]-- != numColors)
+        return;
+    EnableMoves(n);
+    const std::vector<int> &adj = rig-> Neighbors(n);
+    for (int i = 0; i < (int)adj.size(); i++)
+        if (IsAdjacent(adj[i])) EnableMoves(adj[i]);
+    if (state[n] == ToSpill)
+        SetState(n, MoveRelated(n) ? ToFreeze : ToSimplify);
+}
+
+void ColoringAllocator::EnableMoves(int n)
+{
+    for (int i = 0; i < (int)moveList[n].size(); i++) {
+        int m = moveList[n][i];
+        if (moveState[m] == Active) {
+            moveState[m] = Worklist;
+            worklistMoves.push_back(m);
+        }
+    }
+}
+
+void ColoringAllocator::AddWorkList(int n)
+{
+    if (state[n] == ToFreeze && !MoveRelated(n) && degree[n] < numColors)
+        SetState(n, ToSimplify);
+}
+
+/* Method: Conservative
+ * --------------------
+ * Briggs' test: merging u and v is safe if the merged node would have
+ * fewer than numColors neighbors of significant degree, since it is
+ * then sure to be simplified.
+ */
+bool ColoringAllocator::Conservative(int u, int v)
+{
+    int significant = 0;
+    markStamp++;
+    for (int pass = 0; pass < 2; pass++) {
+        const std::vector<int> &adj = rig-> Neighbors(pass == 0 ? u : v);
+        for (int i = 0; i < (int)adj.size(); i++) {
+            int t = adj[i];
+            if (!IsAdjacent(t) || mark[t] == markStamp) continue;
+            mark[t] = markStamp;
+            if (degree[t] >= numColors && ++significant >= numColors)
+                return false;
+        }
+    }
+    return true;
+}
+
+void ColoringAllocator::Combine(int u, int v)
+{
+    state[v] = Coalesced;
+    alias[v] = u;
+    moveList[u].insert(moveList[u].end(), moveList[v].begin(), moveList[v].end());
+    EnableMoves(v);
+    const std::vector<int> &adj = rig-> Neighbors(v);
+    for (int i = 0; i < (int)adj.size(); i++) {
+        int t = adj[i];
+        if (!IsAdjacent(t)) continue;
+        AddEdge(t, u);
+        DecrementDegree(t);
+    }
+    if (degree[u] >= numColors && state[u] == ToFreeze)
+        SetState(u, ToSpill);
+}
+
+/* Method: FreezeMoves
+ * -------------------
+ * Gives up on coalescing the moves of n; the nodes at their other ends
+ * may then be simplified.
+ */
+void ColoringAllocator::FreezeMoves(int n)
+{
+    for (int i = 0; i < (int)moveList[n].size(); i++) {
+        int m = moveList[n][i];
+        if (!IsPending(m)) continue;
+        moveState[m] = Done;
+        int x = GetAlias(rig-> Move(m).first), y = GetAlias(rig-> Move(m).second);
+        int v = (y == GetAlias(n)) ? x : y;
+        AddWorkList(v);
+    }
+}
+
+void ColoringAllocator::Simplify(int n)
+{
+    state[n] = OnStack;
+    selectStack.push_back(n);
+    const std::vector<int> &adj = rig-> Neighbors(n);
+    for (int i = 0; i < (int)adj.size(); i++)
+        if (IsAdjacent(adj[i])) DecrementDegree(adj[i]);
+}
+
+void ColoringAllocator::Coalesce(int m)
+{
+    int u = GetAlias(rig-> Move(m).first), v = GetAlias(rig-> Move(m).second);
+    if (u == v) {
+        moveState[m] = Done;
+        numCoalesced++;
+        AddWorkList(u);
+    } else if (rig-> Interferes(u, v)) {
+        moveState[m] = Done;
+        AddWorkList(u);
+        AddWorkList(v);
+    } else if (Conservative(u, v)) {
+        moveState[m] = Done;
+        numCoalesced++;
+        Combine(u, v);
+        AddWorkList(u);
+    } else
+        moveState[m] = Active;
+}
+
+/* Method: SelectSpill
+ * -------------------
+ * Picks the spill candidate with the lowest cost per neighbor and
+ * pushes it on to be simplified optimistically; it may yet get a color
+ * if its neighbors end up sharing registers. Stale entries are dropped
+ * from the list along the way.
+ */
+void ColoringAllocator::SelectSpill()
+{
+    int best = -1, kept = 0;
+    for (int i = 0; i < (int)spillList.size(); i++) {
+        int n = spillList[i];
+        if (state[n] != ToSpill) continue;
+        spillList[kept++] = n;
+        if (best == -1 || (double)rig-> SpillCost(n) / degree[n] <
+                          (double)rig-> SpillCost(best) / degree[best])
+            best = n;
+    }
+    spillList.resize(kept);
+    if (best == -1)
+        return;
+    SetState(best, ToSimplify);
+    FreezeMoves(best);
+}
+
+/* Method: AssignColors
+ * --------------------
+ * Pops the select stack, giving each node the first color none of its
+ * already colored neighbors has, in the order PickColor prefers for it.
+ * Coalesced nodes take the color of the node they were merged into.
+ */
+void ColoringAllocator::AssignColors()
+{
+    std::vector<char> used(numColors);
+    while (!selectStack.empty()) {
+        int n = selectStack.back();
+        selectStack.pop_back();
+        used.assign(numColors, false);
+        const std::vector<int> &adj = rig-> Neighbors(n);
+        for (int i = 0; i < (int)adj.size(); i++) {
+            int a = GetAlias(adj[i]);
+            if (state[a] == Colored) used[color[a]] = true;
+        }
+        int c = PickColor(used, numColors, firstCalleeSaved, rig-> CallsCrossed(n));
+        if (c != -1) {
+            state[n] = Colored;
+            color[n] = c;
+        } else
+            state[n] = Spilled;
+    }
+    for (int n = 0; n < rig-> NumNodes(); n++)
+        if (state[n] == Coalesced)
+            color[n] = color[GetAlias(n)];
+}
+
+
+static bool StartsBefore(const LiveInterval &a, const LiveInterval &b)
+{
+    return a.start < b.start;
+}
+
+/* Method: LinearScanAllocator
+ * ---------------------------
+ * Visits the intervals in order of start, keeping the ones that hold a
+ * color in active, sorted by end. Intervals that ended before the
+ * current one starts give their colors back. When every color is
+ * taken, whichever of the current interval and the active ones ends
+ * last is spilled, freeing a color for the longest stretch.
+ */
+LinearScanAllocator::LinearScanAllocator(std::vector<LiveInterval> *intervals, int k, int calleeSaved) :
+    numColors(k), firstCalleeSaved(calleeSaved), numSpilled(0)
+{
+    std::stable_sort(intervals-> begin(), intervals-> end(), StartsBefore);
+    std::vector<LiveInterval*> active;
+    std::vector<char> used(numColors, false);
+    for (int i = 0; i < (int)intervals-> size(); i++) {
+        LiveInterval *current = &(*intervals)[i];
+        int expired = 0;
+        while (expired < (int)active.size() && active[expired]-> end < current-> start)
+            used[active[expired++]-> color] = false;
+        active.erase(active.begin(), active.begin() + expired);
+
+        if ((int)active.size() == numColors) {
+            LiveInterval *last = active.back();
+            numSpilled++;
+            if (last-> end <= current-> end) {
+                current-> color = -1;
+                continue;
+            }
+            current-> color = last-> color;
+            last-> color = -1;
+            active.pop_back();
+        } else {
+            int c = PickColor(used, numColors, firstCalleeSaved, current-> callsCrossed);
+            current-> color = c;
+            used[c] = true;
+        }
+        int pos = active.size();
+        while (pos > 0 && active[pos - 1]-> end > current-> end)
+            pos--;
+        active.insert(active.begin() + pos, current);
+    }
+}
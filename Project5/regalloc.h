@@ -0,0 +1,113 @@
+/* File: regalloc.h
+ * ----------------
+ * Register allocators. Both hand out colors 0..numColors-1, which the
+ * Mips class maps to registers; a variable left without a color is
+ * "spilled": it is simply given no register and lives in its stack
+ * slot, which the code generator already handles.
+ *
+ * Colors from firstCalleeSaved up stand for callee-saved registers. A
+ * callee-saved register costs a save and restore on every invocation of
+ * the function using it, where a caller-saved one costs that around
+ * every call it is live across. So variables that cross calls more than
+ * once (weighting calls in loops as several) try the callee-saved colors
+ * first, and everything else tries them last.
+ *
+ * The ColoringAllocator class colors an InterferenceGraph with a fixed
+ * number of colors (registers) using iterated register coalescing, the
+ * simplify/coalesce/freeze/spill worklist algorithm of George and
+ * Appel. Copies recorded in the graph are coalesced whenever Briggs'
+ * conservative test says doing so cannot make the graph harder to
+ * color, so both ends of the copy get the same register and the move
+ * disappears.
+ *
+ * Every phase works from worklists rather than rescanning the graph,
+ * so allocation is close to linear in the size of the graph. Since
+ * spilling needs no new code there is no rewrite-and-retry loop. The
+ * allocator adds edges to the graph as it coalesces nodes.
+ *
+ * The LinearScanAllocator class is the cheap alternative used at -O1.
+ * It needs no interference graph, only one live interval per variable
+ * (the first and last TAC, in layout order, at which it is live or
+ * written), and makes a single pass over the intervals sorted by start,
+ * as described by Poletto and Sarkar.
+ */
+
+#ifndef _H_regalloc
+#define _H_regalloc
+
+#include <vector>
+
+class InterferenceGraph;
+
+class ColoringAllocator {
+  private:
+    typedef enum { ToSimplify, ToFreeze, ToSpill, Coalesced, OnStack, Colored, Spilled } NodeState;
+    typedef enum { Worklist, Active, Done } MoveState;
+
+    InterferenceGraph *rig;
+    int numColors, firstCalleeSaved, numCoalesced;
+
+    std::vector<NodeState> state;
+    std::vector<int> degree, alias, color;
+    std::vector<std::vector<int> > moveList;  // moves each node takes part in
+    std::vector<MoveState> moveState;
+
+    // Worklists hold node/move numbers and are cleaned lazily: an entry
+    // whose state has since changed is skipped when it comes up.
+    std::vector<int> simplifyList, freezeList, spillList, worklistMoves;
+    std::vector<int> selectStack;
+    std::vector<int> mark;  // scratch for the conservative test
+    int markStamp;
+
+    void SetState(int n, NodeState s);
+    bool IsAdjacent(int n)      { return state[n] != OnStack && state[n] != Coalesced; }
+    bool IsPending(int m)       { return moveState[m] != Done; }
+    bool MoveRelated(int n);
+    int GetAlias(int n);
+
+    void AddEdge(int u, int v);
+    void DecrementDegree(int n);
+    void EnableMoves(int n);
+    void AddWorkList(int n);
+    bool Conservative(int u, int v);
+    void Combine(int u, int v);
+    void FreezeMoves(int n);
+
+    void Simplify(int n);
+    void Coalesce(int m);
+    void SelectSpill();
+    void AssignColors();
+
+  public:
+          // Colors rig with colors 0..numColors-1
+    ColoringAllocator(InterferenceGraph *rig, int numColors, int firstCalleeSaved);
+
+          // Color of node n, or -1 if it was spilled
+    int ColorOf(int n) const        { return color[n]; }
+
+          // Number of copies that were coalesced away
+    int NumCoalesced() const        { return numCoalesced; }
+};
+
+
+class Location;
+
+struct LiveInterval {
+    Location *var;
+    int start, end;     // TAC positions, inclusive
+    int callsCrossed;   // weighted count of the calls it is live across
+    int color;          // filled in by the allocator, -1 if spilled
+};
+
+class LinearScanAllocator {
+  private:
+    int numColors, firstCalleeSaved, numSpilled;
+
+  public:
+          // Sorts the intervals by start and colors them
+    LinearScanAllocator(std::vector<LiveInterval> *intervals, int numColors, int firstCalleeSaved);
+
+    int NumSpilled() const          { return numSpilled; }
+};
+
+#endif
@@ -5,21 +5,29 @@
   
 #include "tac.h"
 #include "mips.h"
+#include "intern.h"
+#include "output.h"
 #include <string.h>
 #include <deque>
 
 Location::Location(Segment s, int o, const char *name) :
-    variableName(strdup(name)), segment(s), offset(o){}
+    variableName(Intern(name)), segment(s), offset(o), reference(NULL),
+    refOffset(0), argRegister(-1) {}
 
  
 void Instruction::Print() {
-    printf("\t%s ;", printed);
-    printf("\n");
+    char printed[MaxDescription];
+    Describe(printed, sizeof(printed));
+    AsmOutput()->Printf("\t%s ;\n", printed);
 }
 
 void Instruction::Emit(Mips *mips) {
-    if (*printed)
-        mips->Emit("# %s", printed);   // emit TAC as comment into assembly
+    if (!Terse()) {
+        char printed[MaxDescription];
+        Describe(printed, sizeof(printed));
+        if (*printed)
+            mips->Emit("# %s", printed);   // emit TAC as comment into assembly
+    }
     EmitSpecific(mips);
 }
 
@@ -30,7 +38,10 @@ bool Instruction::Analyze() {
 
 LoadConstant::LoadConstant(Location *d, int v) : dst(d), val(v) {
     Assert(dst != NULL);
-    sprintf(printed, "%s = %d", dst->GetName(), val);
+}
+
+void LoadConstant::Describe(char *buf, int size) {
+    snprintf(buf, size, "%s = %d", dst->GetName(), val);
 }
 
 void LoadConstant::EmitSpecific(Mips *mips) {
@@ -42,19 +53,27 @@ LoadStringConstant::LoadStringConstant(Location *d, const char *s) : dst(d) {
     const char *quote = (*s == '"') ? "" : "\"";
     str = new char[strlen(s) + 2*strlen(quote) + 1];
     sprintf(str, "%s%s%s", quote, s, quote);
-    quote = (strlen(str) > 50) ? "...\"" : "";
-    sprintf(printed, "%s = %.50s%s", dst->GetName(), str, quote);
+    static int strNum = 1;  // numbered here, not when emitted, so that
+    sprintf(label, "_string%d", strNum++); // labels don't depend on emit order
+}
+
+void LoadStringConstant::Describe(char *buf, int size) {
+    const char *quote = (strlen(str) > 50) ? "...\"" : "";
+    snprintf(buf, size, "%s = %.50s%s", dst->GetName(), str, quote);
 }
 
 void LoadStringConstant::EmitSpecific(Mips *mips) {
-    mips->EmitLoadStringConstant(dst, str);
+    mips->EmitLoadStringConstant(dst, label, str);
 }
 
      
 
-LoadLabel::LoadLabel(Location *d, const char *l) : dst(d), label(strdup(l)) {
+LoadLabel::LoadLabel(Location *d, const char *l) : dst(d), label(Intern(l)) {
     Assert(dst != NULL && label != NULL);
-    sprintf(printed, "%s = %s", dst->GetName(), label);
+}
+
+void LoadLabel::Describe(char *buf, int size) {
+    snprintf(buf, size, "%s = %s", dst->GetName(), label);
 }
 
 void LoadLabel::EmitSpecific(Mips *mips) {
@@ -65,7 +84,10 @@ void LoadLabel::EmitSpecific(Mips *mips) {
 
 Assign::Assign(Location *d, Location *s) : dst(d), src(s) {
     Assert(dst != NULL && src != NULL);
-    sprintf(printed, "%s = %s", dst->GetName(), src->GetName());
+}
+
+void Assign::Describe(char *buf, int size) {
+    snprintf(buf, size, "%s = %s", dst->GetName(), src->GetName());
 }
 
 void Assign::EmitSpecific(Mips *mips) {
@@ -76,10 +98,13 @@ void Assign::EmitSpecific(Mips *mips) {
 
 Load::Load(Location *d, Location *s, int off) : dst(d), src(s), offset(off) {
     Assert(dst != NULL && src != NULL);
+}
+
+void Load::Describe(char *buf, int size) {
     if (offset) 
-        sprintf(printed, "%s = *(%s + %d)", dst->GetName(), src->GetName(), offset);
+        snprintf(buf, size, "%s = *(%s + %d)", dst->GetName(), src->GetName(), offset);
     else
-        sprintf(printed, "%s = *(%s)", dst->GetName(), src->GetName());
+        snprintf(buf, size, "%s = *(%s)", dst->GetName(), src->GetName());
 }
 
 void Load::EmitSpecific(Mips *mips) {
@@ -96,10 +121,13 @@ void LoadThis::EmitSpecific(Mips *mips) {
 
 Store::Store(Location *d, Location *s, int off) : dst(d), src(s), offset(off) {
     Assert(dst != NULL && src != NULL);
+}
+
+void Store::Describe(char *buf, int size) {
     if (offset)
-        sprintf(printed, "*(%s + %d) = %s", dst->GetName(), offset, src->GetName());
+        snprintf(buf, size, "*(%s + %d) = %s", dst->GetName(), offset, src->GetName());
     else
-        sprintf(printed, "*(%s) = %s", dst->GetName(), src->GetName());
+        snprintf(buf, size, "*(%s) = %s", dst->GetName(), src->GetName());
 }
 
 void Store::EmitSpecific(Mips *mips) {
@@ -120,7 +148,10 @@ BinaryOp::OpCode BinaryOp::OpCodeForName(const char *name) {
 BinaryOp::BinaryOp(OpCode c, Location *d, Location *o1, Location *o2) : code(c), dst(d), op1(o1), op2(o2) {
     Assert(dst != NULL && op1 != NULL && op2 != NULL);
     Assert(code >= 0 && code < NumOps);
-    sprintf(printed, "%s = %s %s %s", dst->GetName(), op1->GetName(), opName[code], op2->GetName());
+}
+
+void BinaryOp::Describe(char *buf, int size) {
+    snprintf(buf, size, "%s = %s %s %s", dst->GetName(), op1->GetName(), opName[code], op2->GetName());
 }
 
 void BinaryOp::EmitSpecific(Mips *mips) {	  
@@ -129,13 +160,12 @@ void BinaryOp::EmitSpecific(Mips *mips) {
 
 
 
-Label::Label(const char *l) : label(strdup(l)) {
+Label::Label(const char *l) : label(Intern(l)) {
     Assert(label != NULL);
-    *printed = '\0';
 }
 
 void Label::Print() {
-    printf("%s:\n", label);
+    AsmOutput()->Printf("%s:\n", label);
 }
 
 void Label::EmitSpecific(Mips *mips) {
@@ -144,9 +174,12 @@ void Label::EmitSpecific(Mips *mips) {
 
 
  
-Goto::Goto(const char *l) : label(strdup(l)) {
+Goto::Goto(const char *l) : label(Intern(l)) {
     Assert(label != NULL);
-    sprintf(printed, "Goto %s", label);
+}
+
+void Goto::Describe(char *buf, int size) {
+    snprintf(buf, size, "Goto %s", label);
 }
 
 void Goto::EmitSpecific(Mips *mips) {	  
@@ -154,9 +187,12 @@ void Goto::EmitSpecific(Mips *mips) {
 }
 
 
-IfZ::IfZ(Location *te, const char *l) : test(te), label(strdup(l)) {
+IfZ::IfZ(Location *te, const char *l) : test(te), label(Intern(l)) {
     Assert(test != NULL && label != NULL);
-    sprintf(printed, "IfZ %s Goto %s", test->GetName(), label);
+}
+
+void IfZ::Describe(char *buf, int size) {
+    snprintf(buf, size, "IfZ %s Goto %s", test->GetName(), label);
 }
 
 void IfZ::EmitSpecific(Mips *mips) {	  
@@ -165,19 +201,66 @@ void IfZ::EmitSpecific(Mips *mips) {
 
 
 
+const char * const IfCompare::condName[IfCompare::NumConds] = {"==", "!=", "<", "<=", ">", ">="};
+
+IfCompare::Condition IfCompare::Negate(Condition cond) {
+    static const Condition negated[NumConds] = {Ne, Eq, GreaterEq, Greater, LessEq, Less};
+    return negated[cond];
+}
+
+IfCompare::IfCompare(Condition c, Location *o1, Location *o2, const char *l)
+  : cond(c), op1(o1), op2(o2), label(Intern(l)) {
+    Assert(op1 != NULL && op2 != NULL && label != NULL);
+    Assert(cond >= 0 && cond < NumConds);
+}
+
+void IfCompare::Describe(char *buf, int size) {
+    snprintf(buf, size, "If %s %s %s Goto %s", op1->GetName(), condName[cond],
+             op2->GetName(), label);
+}
+
+void IfCompare::EmitSpecific(Mips *mips) {
+    mips->EmitIfCompare(cond, op1, op2, label);
+}
+
+
+IfInBounds::IfInBounds(Location *i, Location *c, const char *l)
+  : index(i), count(c), label(Intern(l)) {
+    Assert(index != NULL && count != NULL && label != NULL);
+}
+
+void IfInBounds::Describe(char *buf, int size) {
+    snprintf(buf, size, "IfInBounds %s < %s Goto %s", index->GetName(),
+             count->GetName(), label);
+}
+
+void IfInBounds::EmitSpecific(Mips *mips) {
+    mips->EmitIfInBounds(index, count, label);
+}
+
+
+
 BeginFunc::BeginFunc() {
-    sprintf(printed,"BeginFunc (unassigned)");
     frameSize = -555; // used as sentinel to recognized unassigned value
+    paramBytes = 0;
+    topLabel = NULL;
 }
 
 BeginFunc::BeginFunc(bool IsMethodDecl) : IsMethodDecl(IsMethodDecl) {
-    sprintf(printed,"BeginFunc (unassigned)");
     frameSize = -555; // used as sentinel to recognized unassigned value
+    paramBytes = 0;
+    topLabel = NULL;
 }
 
 void BeginFunc::SetFrameSize(int numBytesForAllLocalsAndTemps) {
     frameSize = numBytesForAllLocalsAndTemps; 
-    sprintf(printed,"BeginFunc %d", frameSize);
+}
+
+void BeginFunc::Describe(char *buf, int size) {
+    if (frameSize == -555)
+        snprintf(buf, size, "BeginFunc (unassigned)");
+    else
+        snprintf(buf, size, "BeginFunc %d", frameSize);
 }
 
 void BeginFunc::EmitSpecific(Mips *mips) {
@@ -186,7 +269,10 @@ void BeginFunc::EmitSpecific(Mips *mips) {
 
 
 EndFunc::EndFunc() : Instruction() {
-    sprintf(printed, "EndFunc");
+}
+
+void EndFunc::Describe(char *buf, int size) {
+    snprintf(buf, size, "EndFunc");
 }
 
 void EndFunc::EmitSpecific(Mips *mips) {
@@ -196,7 +282,10 @@ void EndFunc::EmitSpecific(Mips *mips) {
 
  
 Return::Return(Location *v) : val(v) {
-    sprintf(printed, "Return %s", val? val->GetName() : "");
+}
+
+void Return::Describe(char *buf, int size) {
+    snprintf(buf, size, "Return %s", val? val->GetName() : "");
 }
 
 void Return::EmitSpecific(Mips *mips) {	  
@@ -207,7 +296,10 @@ void Return::EmitSpecific(Mips *mips) {
 
 PushParam::PushParam(Location *p) :  param(p) {
     Assert(param != NULL);
-    sprintf(printed, "PushParam %s", param->GetName());
+}
+
+void PushParam::Describe(char *buf, int size) {
+    snprintf(buf, size, "PushParam %s", param->GetName());
 }
 
 void PushParam::EmitSpecific(Mips *mips) {
@@ -215,8 +307,24 @@ void PushParam::EmitSpecific(Mips *mips) {
 } 
 
 
+RegParam::RegParam(Location *p, int n) :  param(p), reg(n) {
+    Assert(param != NULL);
+}
+
+void RegParam::Describe(char *buf, int size) {
+    snprintf(buf, size, "PushParam %s in $a%d", param->GetName(), reg);
+}
+
+void RegParam::EmitSpecific(Mips *mips) {
+    mips->EmitRegParam(param, reg);
+}
+
+
 PopParams::PopParams(int nb) : numBytes(nb) {
-    sprintf(printed, "PopParams %d", numBytes);
+}
+
+void PopParams::Describe(char *buf, int size) {
+    snprintf(buf, size, "PopParams %d", numBytes);
 }
 
 void PopParams::EmitSpecific(Mips *mips) {
@@ -229,20 +337,27 @@ void CallerSave::EmitSpecific(Mips *mips) {
     }
 }
 
-CallerLoad::CallerLoad(Location *d, Location *t) : dst(d), th(t) {}
+CallerLoad::CallerLoad(Location *d, Location *t, bool entry) : dst(d), th(t), atEntry(entry) {}
 
 void CallerLoad::EmitSpecific(Mips *mips) {
 
 
 
-    for (int i = 0; i < this->liveVariables.NumElements(); ++i) {
-        mips->RestoreCaller(this->liveVariables.Nth(i));
+    if (atEntry)
+        mips->FillOnEntry(&this->liveVariables);
+    else {
+        for (int i = 0; i < this->liveVariables.NumElements(); ++i)
+            if (this->liveVariables.Nth(i) != dst)   // about to get $v0
+                mips->RestoreCaller(this->liveVariables.Nth(i));
     }
     mips->EmitCallInstrReturn(dst);
 }
 
-LCall::LCall(const char *l, Location *d) : label(strdup(l)), dst(d) {
-    sprintf(printed, "%s%sLCall %s", dst? dst->GetName(): "", dst?" = ":"", label);
+LCall::LCall(const char *l, Location *d) : label(Intern(l)), dst(d) {
+}
+
+void LCall::Describe(char *buf, int size) {
+    snprintf(buf, size, "%s%sLCall %s", dst? dst->GetName(): "", dst?" = ":"", label);
 }
 
 void LCall::EmitSpecific(Mips *mips) {
@@ -258,7 +373,10 @@ void LCall::EmitSpecific(Mips *mips) {
 
 ACall::ACall(Location *ma, Location *d) : dst(d), methodAddr(ma) {
     Assert(methodAddr != NULL);
-    sprintf(printed, "%s%sACall %s", dst? dst->GetName(): "", dst?" = ":"",
+}
+
+void ACall::Describe(char *buf, int size) {
+    snprintf(buf, size, "%s%sACall %s", dst? dst->GetName(): "", dst?" = ":"",
 	    methodAddr->GetName());
 }
 
@@ -273,17 +391,34 @@ void ACall::EmitSpecific(Mips *mips) {
 } 
 
 
+TailCall::TailCall(const char *l, Location *ma, int nb) :
+    label(l ? Intern(l) : NULL), methodAddr(ma), numBytes(nb) {
+    Assert((label != NULL) != (methodAddr != NULL));
+}
 
-VTable::VTable(const char *l, List<const char *> *m) : methodLabels(m), label(strdup(l)) {
+void TailCall::Describe(char *buf, int size) {
+    snprintf(buf, size, "TailCall %s", label ? label : methodAddr->GetName());
+}
+
+void TailCall::EmitSpecific(Mips *mips) {
+    mips->EmitTailCall(label, methodAddr, numBytes);
+}
+
+
+
+VTable::VTable(const char *l, List<const char *> *m) : methodLabels(m), label(Intern(l)) {
     Assert(methodLabels != NULL && label != NULL);
-    sprintf(printed, "VTable for class %s", l);
+}
+
+void VTable::Describe(char *buf, int size) {
+    snprintf(buf, size, "VTable for class %s", label);
 }
 
 void VTable::Print() {
-    printf("VTable %s =\n", label);
+    AsmOutput()->Printf("VTable %s =\n", label);
     for (int i = 0; i < methodLabels->NumElements(); i++) 
-        printf("\t%s,\n", methodLabels->Nth(i));
-    printf("; \n"); 
+        AsmOutput()->Printf("\t%s,\n", methodLabels->Nth(i));
+    AsmOutput()->Append("; \n");
 }
 
 void VTable::EmitSpecific(Mips *mips) {
@@ -8,7 +8,9 @@
  * few fields, but each responds polymorphically to the methods
  * Print and Emit, the first is used to print out the TAC form of
  * the instruction (helpful when debugging) and the second to
- * convert to the appropriate MIPS assembly.
+ * convert to the appropriate MIPS assembly. The TAC form is not kept
+ * around; Describe writes it out on demand, for Print and for the
+ * comment Emit puts in front of the assembly.
  *
  * The operands to each instruction are of Location class.
  * A Location object is a simple representation of where a variable
@@ -24,6 +26,7 @@
 #define _H_tac
 
 #include "list.h" // for VTable
+#include "arena.h"
 #include <set>
 #include <map>
 // #include "mips.h"
@@ -43,20 +46,22 @@ typedef enum {fpRelative, gpRelative} Segment;
 class Location
 {
   protected:
-    const char *variableName;
+    const char *variableName;   // interned, see intern.h
     Segment segment;
     int offset;
     Location *reference;
     int refOffset;
-    int spillCost;
-    List<Location*> interferences;
+    int argRegister;   // n if this formal arrives in $a<n>, else -1
     // Mips::Register regst;
 	  
   public:
     Location(Segment seg, int offset, const char *name);
+    static void *operator new(size_t size) { return TacArena()->Allocate(size); }
+    static void operator delete(void *p) {}
     Location(Location *base, int refOff) :
 	variableName(base->variableName), segment(base->segment),
-	offset(base->offset), reference(base), refOffset(refOff) {}
+	offset(base->offset), reference(base), refOffset(refOff),
+	argRegister(-1) {}
  
     const char *GetName()           { return variableName; }
     Segment GetSegment()            { return segment; }
@@ -64,42 +69,57 @@ class Location
     bool IsReference()              { return reference != NULL; }
     Location *GetReference()        { return reference; }
     int GetRefOffset()              { return refOffset; }
-    void IncrementSpillCost() { ++spillCost; }
-    double GetScore() { return static_cast<double>(spillCost) / interferences.NumElements(); }
-    void AddInterference(Location *loc) {
-	    interferences.Remove(loc);
-	    interferences.Append(loc);
-    }
-    List<Location*> *GetInterferences() { return &interferences; }
+    void SetArgRegister(int n)      { argRegister = n; }
+    int GetArgRegister()            { return argRegister; }
     // void SetRegister(Mips::Register reg) { regst = reg; }
     // Mips::Register GetRegister() { return regst; }
 };
  
 
 
+  // Maps the variables and code labels of one function to those of
+  // another, so that its TAC can be copied there (see Instruction::Clone)
+class Renaming {
+  public:
+    virtual Location *RenameVar(Location *var) = 0;      // NULL stays NULL
+    virtual const char *RenameLabel(const char *label) = 0;
+};
+
+
   // base class from which all Tac instructions derived
   // has the interface for the 2 polymorphic messages: Print & Emit
   
 class Instruction {
-  protected:
-    char printed[128];
-	  
   public:
+    static const int MaxDescription = 128;
+
+    // Instructions live in the TAC arena (see arena.h)
+    static void *operator new(size_t size) { return TacArena()->Allocate(size); }
+    static void operator delete(void *p) {}
+
 	virtual void Print();
 	virtual void EmitSpecific(Mips *mips) = 0;
 	virtual void Emit(Mips *mips);
-    void AddSuccessor(Instruction* tac) { successors.Append(tac); }
-    List<Location*> *GetLiveVariables() { return &liveVariables; }
-    virtual void SetKill() { return; }
-    virtual void SetGen() { return; }
-    List<Instruction*> successors;  // can be changed to std::list due to the new operation in constructor of children classes ???
-	List<Location*> liveVariables;
-    // type of elements need to be Location* ???
-    std::set<Location*> in_set;
-    std::set<Location*> intemp_set;
-    std::set<Location*> out_set;
-    std::set<Location*> kill_set;
-    std::set<Location*> gen_set;
+
+    // Writes the TAC form into buf (at most size bytes), or an empty
+    // string for instructions that have none
+    virtual void Describe(char *buf, int size) { *buf = '\0'; }
+
+    // Dataflow hooks: the variable this instruction writes (its kill)
+    // and the up to MaxGen variables it reads (its gen), which the gen
+    // array is filled with. Liveness is computed from just these two.
+    // ReplaceGen makes the instruction read var instead of old wherever
+    // it read old, which is how the optimizer propagates copies.
+    static const int MaxGen = 2;
+    virtual Location *GetKill() { return NULL; }
+    virtual int GetGen(Location *gen[MaxGen]) { return 0; }
+    virtual void ReplaceGen(Location *old, Location *var) {}
+
+    // Inlining hook: returns a copy of the instruction that uses the
+    // variables and labels renaming maps its own to, or NULL for those
+    // that only make sense once per function (BeginFunc, EndFunc,
+    // VTable).
+    virtual Instruction *Clone(Renaming *r) { return NULL; }
     bool Analyze();
     /*Abstract function for all children class. Uncomment and implement for the other children classes*/
     //virtual void AnalyzeSpecific() = 0;
@@ -120,35 +140,43 @@ class BinaryOp;
 class Label;
 class Goto;
 class IfZ;
+class IfCompare;
+class IfInBounds;
 class BeginFunc;
 class EndFunc;
 class Return;
 class PushParam;
+class RegParam;
 class RemoveParams;
+class CallBoundary;
 class LCall;
 class ACall;
+class TailCall;
 class VTable;
 
 
-typedef std::map<Location*, std::set<Location*> > INTERFERENCEGRAPH;
-
-
 class LoadConstant: public Instruction {
     Location *dst;
     int val;
   public:
     LoadConstant(Location *dst, int val);
     void EmitSpecific(Mips *mips);
-    void SetKill() { kill_set.insert(dst); }
+    void Describe(char *buf, int size);
+    int GetValue() { return val; }
+    Location *GetKill() { return dst; }
+    Instruction *Clone(Renaming *r) { return new LoadConstant(r->RenameVar(dst), val); }
 };
 
 class LoadStringConstant: public Instruction {
     Location *dst;
     char *str;
+    char label[16];
   public:
     LoadStringConstant(Location *dst, const char *s);
     void EmitSpecific(Mips *mips);
-    void SetKill() { kill_set.insert(dst); }
+    void Describe(char *buf, int size);
+    Location *GetKill() { return dst; }
+    Instruction *Clone(Renaming *r) { return new LoadStringConstant(r->RenameVar(dst), str); }
 };
     
 class LoadLabel: public Instruction {
@@ -157,7 +185,10 @@ class LoadLabel: public Instruction {
   public:
     LoadLabel(Location *dst, const char *label);
     void EmitSpecific(Mips *mips);
-    void SetKill() { kill_set.insert(dst); }
+    void Describe(char *buf, int size);
+    const char *GetLabel() { return label; }
+    Location *GetKill() { return dst; }
+    Instruction *Clone(Renaming *r) { return new LoadLabel(r->RenameVar(dst), label); }
 };
 
 class Assign: public Instruction {
@@ -165,8 +196,11 @@ class Assign: public Instruction {
   public:
     Assign(Location *dst, Location *src);
     void EmitSpecific(Mips *mips);
-    void SetKill() { kill_set.insert(dst); }
-    void SetGen() { gen_set.insert(src); }
+    void Describe(char *buf, int size);
+    Location *GetKill() { return dst; }
+    int GetGen(Location *gen[]) { gen[0] = src; return 1; }
+    void ReplaceGen(Location *old, Location *var) { if (src == old) src = var; }
+    Instruction *Clone(Renaming *r) { return new Assign(r->RenameVar(dst), r->RenameVar(src)); }
 };
 
 class Load: public Instruction {
@@ -175,8 +209,12 @@ class Load: public Instruction {
   public:
     Load(Location *dst, Location *src, int offset = 0);
     void EmitSpecific(Mips *mips);
-    void SetKill() { kill_set.insert(dst); }
-    void SetGen() { gen_set.insert(src); }
+    void Describe(char *buf, int size);
+    int GetOffset() { return offset; }
+    Location *GetKill() { return dst; }
+    int GetGen(Location *gen[]) { gen[0] = src; return 1; }
+    void ReplaceGen(Location *old, Location *var) { if (src == old) src = var; }
+    Instruction *Clone(Renaming *r) { return new Load(r->RenameVar(dst), r->RenameVar(src), offset); }
 };
 
 class LoadThis: public Instruction {
@@ -184,7 +222,8 @@ class LoadThis: public Instruction {
   public:
     LoadThis(Location *src);
     void EmitSpecific(Mips *mips);
-    void SetGen() { gen_set.insert(src); }
+    int GetGen(Location *gen[]) { gen[0] = src; return 1; }
+    Instruction *Clone(Renaming *r) { return new LoadThis(r->RenameVar(src)); }
 };
 
 class Store: public Instruction {
@@ -193,7 +232,11 @@ class Store: public Instruction {
   public:
     Store(Location *d, Location *s, int offset = 0);
     void EmitSpecific(Mips *mips);
-    void SetGen() { gen_set.insert(src); gen_set.insert(dst); }
+    void Describe(char *buf, int size);
+    int GetGen(Location *gen[]) { gen[0] = src; gen[1] = dst; return 2; }
+    void ReplaceGen(Location *old, Location *var)
+        { if (src == old) src = var; if (dst == old) dst = var; }
+    Instruction *Clone(Renaming *r) { return new Store(r->RenameVar(dst), r->RenameVar(src), offset); }
 };
 
 class BinaryOp: public Instruction {
@@ -208,8 +251,14 @@ class BinaryOp: public Instruction {
   public:
     BinaryOp(OpCode c, Location *dst, Location *op1, Location *op2);
     void EmitSpecific(Mips *mips);
-    void SetKill() { kill_set.insert(dst); }
-    void SetGen() { gen_set.insert(op1); gen_set.insert(op2); }
+    void Describe(char *buf, int size);
+    OpCode GetOpCode() { return code; }
+    Location *GetKill() { return dst; }
+    int GetGen(Location *gen[]) { gen[0] = op1; gen[1] = op2; return 2; }
+    void ReplaceGen(Location *old, Location *var)
+        { if (op1 == old) op1 = var; if (op2 == old) op2 = var; }
+    Instruction *Clone(Renaming *r)
+        { return new BinaryOp(code, r->RenameVar(dst), r->RenameVar(op1), r->RenameVar(op2)); }
 };
 
 class Label: public Instruction {
@@ -219,6 +268,7 @@ class Label: public Instruction {
     void Print();
     void EmitSpecific(Mips *mips);
     const char *GetLabel() { return label; }
+    Instruction *Clone(Renaming *r) { return new Label(r->RenameLabel(label)); }
 };
 
 class Goto: public Instruction {
@@ -226,7 +276,9 @@ class Goto: public Instruction {
   public:
     Goto(const char *label);
     void EmitSpecific(Mips *mips);
+    void Describe(char *buf, int size);
     const char *GetLabel() { return label; }
+    Instruction *Clone(Renaming *r) { return new Goto(r->RenameLabel(label)); }
 };
 
 class IfZ: public Instruction {
@@ -235,27 +287,81 @@ class IfZ: public Instruction {
   public:
     IfZ(Location *test, const char *label);
     void EmitSpecific(Mips *mips);
+    void Describe(char *buf, int size);
     const char *GetLabel() { return label; }
-    void SetGen() { gen_set.insert(test); }
+    int GetGen(Location *gen[]) { gen[0] = test; return 1; }
+    void ReplaceGen(Location *old, Location *var) { if (test == old) test = var; }
+    Instruction *Clone(Renaming *r) { return new IfZ(r->RenameVar(test), r->RenameLabel(label)); }
+};
+
+  // Branches to label if op1 and op2 compare as cond says, which is
+  // what the test of an if or loop comes to when it is a comparison
+class IfCompare: public Instruction {
+  public:
+    typedef enum {Eq, Ne, Less, LessEq, Greater, GreaterEq, NumConds} Condition;
+    static const char * const condName[NumConds];
+    static Condition Negate(Condition cond);
+
+  protected:
+    Condition cond;
+    Location *op1, *op2;
+    const char *label;
+  public:
+    IfCompare(Condition cond, Location *op1, Location *op2, const char *label);
+    void EmitSpecific(Mips *mips);
+    void Describe(char *buf, int size);
+    Condition GetCondition() { return cond; }
+    const char *GetLabel() { return label; }
+    int GetGen(Location *gen[]) { gen[0] = op1; gen[1] = op2; return 2; }
+    void ReplaceGen(Location *old, Location *var)
+        { if (op1 == old) op1 = var; if (op2 == old) op2 = var; }
+    Instruction *Clone(Renaming *r)
+        { return new IfCompare(cond, r->RenameVar(op1), r->RenameVar(op2), r->RenameLabel(label)); }
+};
+
+  // Branches to label if 0 <= index < count, the test an array
+  // subscript makes before touching the element
+class IfInBounds: public Instruction {
+    Location *index, *count;
+    const char *label;
+  public:
+    IfInBounds(Location *index, Location *count, const char *label);
+    void EmitSpecific(Mips *mips);
+    void Describe(char *buf, int size);
+    const char *GetLabel() { return label; }
+    Location *GetIndex() { return index; }
+    Location *GetCount() { return count; }
+    int GetGen(Location *gen[]) { gen[0] = index; gen[1] = count; return 2; }
+    void ReplaceGen(Location *old, Location *var)
+        { if (index == old) index = var; if (count == old) count = var; }
+    Instruction *Clone(Renaming *r)
+        { return new IfInBounds(r->RenameVar(index), r->RenameVar(count), r->RenameLabel(label)); }
 };
 
 class BeginFunc: public Instruction {
     int frameSize;
+    int paramBytes;     // of the parameters callers pass on the stack
+    const char *topLabel;   // for a tail call to the function itself
     bool IsMethodDecl;
   public:
     BeginFunc();
     BeginFunc(bool IsMethodDecl);
     // used to backpatch the instruction with frame size once known
     void SetFrameSize(int numBytesForAllLocalsAndTemps);
+    int GetFrameSize() { return frameSize; }
+    void SetParamBytes(int numBytes) { paramBytes = numBytes; }
+    int GetParamBytes() { return paramBytes; }
+    void SetTopLabel(const char *label) { topLabel = label; }
+    const char *GetTopLabel() { return topLabel; }
     void EmitSpecific(Mips *mips);
-    void SetGen() { return; }
-    // INTERFERENCEGRAPH inter_graph;
+    void Describe(char *buf, int size);
 };
 
 class EndFunc: public Instruction {
   public:
     EndFunc();
     void EmitSpecific(Mips *mips);
+    void Describe(char *buf, int size);
 };
 
 class Return: public Instruction {
@@ -263,7 +369,10 @@ class Return: public Instruction {
   public:
     Return(Location *val);
     void EmitSpecific(Mips *mips);
-    void SetGen() { if (val) gen_set.insert(val); }
+    void Describe(char *buf, int size);
+    int GetGen(Location *gen[]) { gen[0] = val; return val ? 1 : 0; }
+    void ReplaceGen(Location *old, Location *var) { if (val == old) val = var; }
+    Instruction *Clone(Renaming *r) { return new Return(r->RenameVar(val)); }
 };   
 
 class PushParam: public Instruction {
@@ -271,29 +380,63 @@ class PushParam: public Instruction {
   public:
     PushParam(Location *param);
     void EmitSpecific(Mips *mips);
-    void SetGen() { gen_set.insert(param); }
+    void Describe(char *buf, int size);
+    int GetGen(Location *gen[]) { gen[0] = param; return 1; }
+    void ReplaceGen(Location *old, Location *var) { if (param == old) param = var; }
+    Instruction *Clone(Renaming *r) { return new PushParam(r->RenameVar(param)); }
 }; 
 
+  // Passes a parameter in $a<n> rather than on the stack
+class RegParam: public Instruction {
+    Location *param;
+    int reg;
+  public:
+    RegParam(Location *param, int n);
+    void EmitSpecific(Mips *mips);
+    void Describe(char *buf, int size);
+    int GetRegister() { return reg; }
+    int GetGen(Location *gen[]) { gen[0] = param; return 1; }
+    void ReplaceGen(Location *old, Location *var) { if (param == old) param = var; }
+    Instruction *Clone(Renaming *r) { return new RegParam(r->RenameVar(param), reg); }
+};
+
 class PopParams: public Instruction {
     int numBytes;
   public:
     PopParams(int numBytesOfParamsToRemove);
     void EmitSpecific(Mips *mips);
+    void Describe(char *buf, int size);
+    Instruction *Clone(Renaming *r) { return new PopParams(numBytes); }
 }; 
 
-class CallerSave: public Instruction {
+  // Base of CallerSave and CallerLoad, which need to know what is live
+  // around the call when they are emitted. The back end fills the list
+  // in just for that (other instructions' live sets are kept apart by
+  // the analysis that needs them).
+class CallBoundary: public Instruction {
+  protected:
+    List<Location*> liveVariables;
+  public:
+    List<Location*> *GetLiveVariables() { return &liveVariables; }
+};
+
+class CallerSave: public CallBoundary {
 
   public:
 
     void EmitSpecific(Mips *mips);
+    Instruction *Clone(Renaming *r) { return new CallerSave(); }
 }; 
 
-class CallerLoad: public Instruction {
+class CallerLoad: public CallBoundary {
     Location *dst;
     Location *th;
+    bool atEntry;   // loads the live-in formals rather than following a call
   public:
-    CallerLoad(Location *d, Location *t);
+    CallerLoad(Location *d, Location *t, bool entry = false);
     void EmitSpecific(Mips *mips);
+    bool IsAtEntry() { return atEntry; }
+    Instruction *Clone(Renaming *r) { return new CallerLoad(r->RenameVar(dst), r->RenameVar(th), atEntry); }
 }; 
 
 class LCall: public Instruction {
@@ -302,7 +445,10 @@ class LCall: public Instruction {
   public:
     LCall(const char *labe, Location *result);
     void EmitSpecific(Mips *mips);
-    void SetKill() { kill_set.insert(dst); }
+    void Describe(char *buf, int size);
+    const char *GetLabel() { return label; }
+    Location *GetKill() { return dst; }
+    Instruction *Clone(Renaming *r) { return new LCall(label, r->RenameVar(dst)); }
 };
 
 class ACall: public Instruction {
@@ -310,7 +456,29 @@ class ACall: public Instruction {
   public:
     ACall(Location *meth, Location *result);
     void EmitSpecific(Mips *mips);
-    void SetKill() { kill_set.insert(dst); }
+    void Describe(char *buf, int size);
+    Location *GetKill() { return dst; }
+    int GetGen(Location *gen[]) { gen[0] = methodAddr; return 1; }
+    void ReplaceGen(Location *old, Location *var) { if (methodAddr == old) methodAddr = var; }
+    Instruction *Clone(Renaming *r) { return new ACall(r->RenameVar(methodAddr), r->RenameVar(dst)); }
+};
+
+  // Ends the function with a call whose result is its own: the callee,
+  // named by label or held in methodAddr, takes the function's place on
+  // the stack and returns straight to its caller. The parameters pushed
+  // for it (numBytes of them) are moved to where the function's own came
+  // in, which must have room for them.
+class TailCall: public Instruction {
+    const char *label;
+    Location *methodAddr;
+    int numBytes;
+  public:
+    TailCall(const char *label, Location *meth, int numBytesOfParams);
+    void EmitSpecific(Mips *mips);
+    void Describe(char *buf, int size);
+    int GetGen(Location *gen[]) { gen[0] = methodAddr; return methodAddr ? 1 : 0; }
+    void ReplaceGen(Location *old, Location *var) { if (methodAddr == old) methodAddr = var; }
+    Instruction *Clone(Renaming *r) { return new TailCall(label, r->RenameVar(methodAddr), numBytes); }
 };
 
 class VTable: public Instruction {
@@ -320,6 +488,7 @@ class VTable: public Instruction {
     VTable(const char *labelForTable, List<const char *> *methodLabels);
     void Print();
     void EmitSpecific(Mips *mips);
+    void Describe(char *buf, int size);
 };
 
 
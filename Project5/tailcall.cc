@@ -0,0 +1,79 @@
+/* File: tailcall.cc
+ * -----------------
+ * Tail-call elimination over the TAC of one function.
+ */
+
+#include "optimize.h"
+#include "callsite.h"
+#include "codegen.h"
+#include "tac.h"
+#include <vector>
+
+
+/* Function: IsTailPosition
+ * ------------------------
+ * Returns true if what follows a call, code[next], ends the function
+ * with the call's result or with nothing: a Return of the result or of
+ * no value, or the EndFunc.
+ */
+static bool IsTailPosition(List<Instruction*> *code, int next, Location *result)
+{
+    if (dynamic_cast<EndFunc*> (code-> Nth(next))) return true;
+    Return *ret = dynamic_cast<Return*> (code-> Nth(next));
+    Location *val;
+    return ret && (ret-> GetGen(&val) == 0 || val == result);
+}
+
+/* Function: EliminateTailCalls
+ * ----------------------------
+ * A call to the function itself becomes a jump back to its start, the
+ * arguments first copied into new variables and from there into the
+ * formals, since one may be computed from another. The label jumped
+ * to was made along with the BeginFunc, so that it does not depend on
+ * which thread gets here first. Any other call
+ * becomes a TailCall when the callee takes no more of the stack for
+ * its parameters than the function itself was given.
+ */
+bool EliminateTailCalls(List<Instruction*> *tac, const char *self)
+{
+    BeginFunc *frame = dynamic_cast<BeginFunc*> (tac-> Nth(0));
+    Assert(frame != NULL && dynamic_cast<CallerLoad*> (tac-> Nth(1)));
+    std::vector<Location*> formals;
+    FindFormals(tac, &formals);
+    List<Instruction*> out;
+    bool changed = false, loops = false;
+    for (int i = 0; i < tac-> NumElements(); i++) {
+        CallSite site;
+        if (!dynamic_cast<CallerSave*> (tac-> Nth(i)) || !MatchCall(tac, i, &site) ||
+            !IsTailPosition(tac, site.last + 1, site.result)) {
+            out.Append(tac-> Nth(i));
+            continue;
+        }
+        int bytes = site.pushed.size() * CodeGenerator::VarSize;
+        if (site.label == self) {
+            std::vector<Location*> args;
+            for (int f = 0; f < (int)formals.size(); f++) {
+                args.push_back(NewFrameVariable(frame, formals[f]-> GetName()));
+                out.Append(new Assign(args[f], ArgumentFor(formals[f], site)));
+            }
+            for (int f = 0; f < (int)formals.size(); f++)
+                out.Append(new Assign(formals[f], args[f]));
+            Assert(frame-> GetTopLabel() != NULL);
+            out.Append(new Goto(frame-> GetTopLabel()));
+            loops = true;
+        } else if (bytes <= frame-> GetParamBytes()) {
+            for (int j = site.first; j < site.call; j++)
+                out.Append(tac-> Nth(j));
+            out.Append(new TailCall(site.label, site.addr, bytes));
+        } else {
+            out.Append(tac-> Nth(i));
+            continue;
+        }
+        i = dynamic_cast<Return*> (tac-> Nth(site.last + 1)) ? site.last + 1 : site.last;
+        changed = true;
+    }
+    if (!changed) return false;
+    if (loops) out.InsertAt(new Label(frame-> GetTopLabel()), 2);   // after the entry CallerLoad
+    *tac = out;
+    return true;
+}
@@ -66,17 +66,58 @@ void PrintDebug(const char *key, const char *format, ...)
 }
 
 
+static int numJobs = 1;
+static int optLevel = 2;
+static bool registerArgs = false;
+static const char *outputFileName = NULL;
+static bool terse = false;
+
+int NumJobs()
+{
+  return numJobs;
+}
+
+int OptLevel()
+{
+  return optLevel;
+}
+
+bool RegisterArgs()
+{
+  return registerArgs;
+}
+
+const char *OutputFileName()
+{
+  return outputFileName;
+}
+
+bool Terse()
+{
+  return terse;
+}
+
 void ParseCommandLine(int argc, char *argv[])
 {
-  if (argc == 1)
-    return;
-  
-  if (strcmp(argv[1], "-d") != 0) { // first arg is not -d
-    printf("Usage:   -d <debug-key-1> <debug-key-2> ... \n");
-    exit(2);
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-j") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+      numJobs = atoi(argv[++i]);
+    } else if (strncmp(argv[i], "-O", 2) == 0 && strlen(argv[i]) == 3 &&
+               argv[i][2] >= '1' && argv[i][2] <= '2') {
+      optLevel = argv[i][2] - '0';
+    } else if (strcmp(argv[i], "-regargs") == 0) {
+      registerArgs = true;
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      outputFileName = argv[++i];
+    } else if (strcmp(argv[i], "-terse") == 0) {
+      terse = true;
+    } else if (strcmp(argv[i], "-d") == 0) {
+      while (i + 1 < argc && argv[i + 1][0] != '-')
+        SetDebugForKey(argv[++i], true);
+    } else {
+      printf("Usage:   [-O1|-O2] [-j <jobs>] [-regargs] [-o <file>] [-terse] [-d <debug-key-1> <debug-key-2> ...] \n");
+      exit(2);
+    }
   }
-
-  for (int i = 2; i < argc; i++)
-    SetDebugForKey(argv[i], true);
 }
 
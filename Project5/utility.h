@@ -72,11 +72,69 @@ bool IsDebugOn(const char *key);
 
 
 
+/* Function: NumJobs()
+ * Usage: if (NumJobs() > 1) ...
+ * ----------------------------
+ * Returns how many threads the back end may use, as set by -j on the
+ * command line. Defaults to 1.
+ */
+int NumJobs();
+
+
+
+/* Function: OptLevel()
+ * Usage: if (OptLevel() >= 2) ...
+ * -------------------------------
+ * Returns the optimization level set by -O1 or -O2 on the command line.
+ * Defaults to 2. Level 1 trades code quality for compile speed, e.g. by
+ * allocating registers with linear scan instead of graph coloring and
+ * skipping the TAC optimizations (see optimize.h).
+ */
+int OptLevel();
+
+
+
+/* Function: RegisterArgs()
+ * Usage: if (RegisterArgs()) ...
+ * ------------------------------
+ * Returns whether calls to Decaf functions and methods pass their first
+ * four arguments (counting the hidden "this") in $a0-$a3 rather than
+ * on the stack, as set by -regargs on the command line. Defaults to
+ * false. Calls to the built-in library functions always use the stack.
+ */
+bool RegisterArgs();
+
+
+
+/* Function: OutputFileName()
+ * Usage: if (OutputFileName()) ...
+ * --------------------------------
+ * Returns the file the output goes to, as set by -o on the command
+ * line, or NULL (the default) for stdout.
+ */
+const char *OutputFileName();
+
+
+
+/* Function: Terse()
+ * Usage: if (!Terse()) Emit("# %s", text);
+ * ----------------------------------------
+ * Returns whether to leave the comments out of the emitted assembly
+ * (the TAC each instruction comes from, spill notes and the like), as
+ * set by -terse on the command line. Defaults to false.
+ */
+bool Terse();
+
+
+
 /* Function: ParseCommandLine
  * --------------------------
- * Turn on the debugging flags from the command line.  Verifies that
- * first argument is -d, and then interpret all the arguments that follow
- * as being flags to turn on.
+ * Reads the options from the command line. -O1/-O2 set the optimization
+ * level; -j is followed by the number of back end threads to use;
+ * -regargs turns on passing arguments in registers; -o is followed by
+ * the output file; -terse leaves comments out of the assembly; -d is
+ * followed by the debugging flags to turn on (every argument up to the
+ * next option).
  */
 void ParseCommandLine(int argc, char *argv[]);
      
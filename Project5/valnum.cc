@@ -0,0 +1,239 @@
+/* File: valnum.cc
+ * ---------------
+ * Value numbering over the extended basic blocks of one function.
+ */
+
+#include "optimize.h"
+#include "cfg.h"
+#include "tac.h"
+#include "codegen.h"
+#include <unordered_map>
+#include <vector>
+
+
+/* Class: ValueTable
+ * -----------------
+ * Numbers the values computed along one path through an extended basic
+ * block. Each frame variable maps to the number of the value it holds,
+ * and each expression computed so far (an operation on numbered
+ * values, a constant, a label, or a load from a numbered address) maps
+ * to its number and the variable it was left in. Globals and memory
+ * can change under a call or store, so every one of those starts a
+ * new epoch: a global's value and a load are only looked up within the
+ * epoch they were entered in. An array's length never changes, so a
+ * load of it belongs to no epoch.
+ *
+ * Everything entered is logged, so that the walk can Mark the table
+ * before going down into a successor and Restore it on the way back.
+ */
+class ValueTable {
+  public:
+    typedef enum { Constant = BinaryOp::NumOps, Label, LoadFrom, Global } Kind;
+
+    struct Key {
+        int kind;               // a BinaryOp::OpCode or one of the above
+        long long a, b, c;
+        bool operator==(const Key &k) const
+            { return kind == k.kind && a == k.a && b == k.b && c == k.c; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key &k) const
+            { return (((size_t)k.kind * 31 + (size_t)k.a) * 1000003 + (size_t)k.b) * 31 + (size_t)k.c; }
+    };
+    struct Value {
+        int number;
+        Location *holder;       // frame variable it was left in, or NULL
+    };
+
+  private:
+    std::unordered_map<Location*, int> varValue;
+    std::unordered_map<Key, Value, KeyHash> exprValue;
+    std::vector<std::pair<Location*, int> > varLog;    // previous values, -1 if none
+    std::vector<std::pair<Key, Value> > exprLog;      // number -1 if none
+    int nextNumber, epoch;
+
+  public:
+    ValueTable() : nextNumber(0), epoch(0) {}
+
+    int NewNumber()                     { return nextNumber++; }
+    int Epoch() const                   { return epoch; }
+    void NewEpoch()                     { epoch = nextNumber++; }
+
+    int NumberOf(Location *var);
+    void SetNumber(Location *var, int number);
+
+          // Returns the expression's value, with number -1 if it is new
+    Value Lookup(const Key &key);
+    void Enter(const Key &key, int number, Location *holder);
+
+    struct Mark { size_t vars, exprs; int epoch; };
+    Mark GetMark() const                { Mark m = { varLog.size(), exprLog.size(), epoch }; return m; }
+    void Restore(const Mark &mark);
+};
+
+/* Method: NumberOf
+ * ----------------
+ * Returns the number of the value var holds, giving it a new one if
+ * nothing is known about it yet.
+ */
+int ValueTable::NumberOf(Location *var)
+{
+    if (var-> GetSegment() != fpRelative) {
+        Key key = { Global, (long long)(size_t)var, epoch, 0 };
+        Value value = Lookup(key);
+        if (value.number == -1)
+            Enter(key, value.number = NewNumber(), NULL);
+        return value.number;
+    }
+    std::unordered_map<Location*, int>::iterator found = varValue.find(var);
+    if (found != varValue.end()) return found-> second;
+    int number = NewNumber();
+    SetNumber(var, number);
+    return number;
+}
+
+void ValueTable::SetNumber(Location *var, int number)
+{
+    if (var-> GetSegment() != fpRelative) {
+        Key key = { Global, (long long)(size_t)var, epoch, 0 };
+        Enter(key, number, NULL);
+        return;
+    }
+    std::unordered_map<Location*, int>::iterator found = varValue.find(var);
+    varLog.push_back(std::make_pair(var, found == varValue.end() ? -1 : found-> second));
+    varValue[var] = number;
+}
+
+ValueTable::Value ValueTable::Lookup(const Key &key)
+{
+    std::unordered_map<Key, Value, KeyHash>::iterator found = exprValue.find(key);
+    if (found != exprValue.end()) return found-> second;
+    Value none = { -1, NULL };
+    return none;
+}
+
+void ValueTable::Enter(const Key &key, int number, Location *holder)
+{
+    exprLog.push_back(std::make_pair(key, Lookup(key)));
+    Value value = { number, holder };
+    exprValue[key] = value;
+}
+
+void ValueTable::Restore(const Mark &mark)
+{
+    while (varLog.size() > mark.vars) {
+        if (varLog.back().second == -1) varValue.erase(varLog.back().first);
+        else varValue[varLog.back().first] = varLog.back().second;
+        varLog.pop_back();
+    }
+    while (exprLog.size() > mark.exprs) {
+        if (exprLog.back().second.number == -1) exprValue.erase(exprLog.back().first);
+        else exprValue[exprLog.back().first] = exprLog.back().second;
+        exprLog.pop_back();
+    }
+    epoch = mark.epoch;
+}
+
+
+/* Function: ExpressionKey
+ * -----------------------
+ * Fills key with what tac computes, in terms of the numbers of its
+ * operands, and returns true; or returns false if tac is not one of
+ * the computations value numbering reuses. Operands of commutative
+ * operations are put in order so that a+b and b+a look the same.
+ */
+static bool ExpressionKey(Instruction *tac, ValueTable *table, ValueTable::Key *key)
+{
+    Location *gen[Instruction::MaxGen];
+    key-> a = key-> b = key-> c = 0;
+    if (LoadConstant *load = dynamic_cast<LoadConstant*> (tac)) {
+        key-> kind = ValueTable::Constant;
+        key-> a = load-> GetValue();
+    } else if (LoadLabel *load = dynamic_cast<LoadLabel*> (tac)) {
+        key-> kind = ValueTable::Label;
+        key-> a = (long long)(size_t)load-> GetLabel();     // interned
+    } else if (Load *load = dynamic_cast<Load*> (tac)) {
+        load-> GetGen(gen);
+        key-> kind = ValueTable::LoadFrom;
+        key-> a = table-> NumberOf(gen[0]);
+        key-> b = load-> GetOffset();
+        key-> c = (key-> b == CodeGenerator::OffsetToArrayLength) ? -1 : table-> Epoch();
+    } else if (BinaryOp *op = dynamic_cast<BinaryOp*> (tac)) {
+        op-> GetGen(gen);
+        BinaryOp::OpCode code = op-> GetOpCode();
+        key-> kind = code;
+        key-> a = table-> NumberOf(gen[0]);
+        key-> b = table-> NumberOf(gen[1]);
+        bool commutes = (code == BinaryOp::Add || code == BinaryOp::Mul || code == BinaryOp::Eq ||
+                         code == BinaryOp::And || code == BinaryOp::Or);
+        if (commutes && key-> a > key-> b) std::swap(key-> a, key-> b);
+    } else
+        return false;
+    return true;
+}
+
+/* Function: NumberBlock
+ * ---------------------
+ * Value numbers block with what table knows on entry to it, replacing
+ * each recomputation of a value still held in a frame variable by a
+ * copy of that variable, then goes on into the successors that have
+ * no other predecessor, as they can only be entered with what the
+ * table knows at the end of this block.
+ */
+static bool NumberBlock(BasicBlock *block, ValueTable *table)
+{
+    bool changed = false;
+    ValueTable::Mark mark = table-> GetMark();
+    for (int i = 0; i < block-> code.NumElements(); i++) {
+        Instruction *instr = block-> code.Nth(i);
+        Location *dst = instr-> GetKill(), *src;
+        ValueTable::Key key;
+        if (ExpressionKey(instr, table, &key)) {
+            ValueTable::Value value = table-> Lookup(key);
+            if (value.number != -1 && value.holder && table-> NumberOf(value.holder) == value.number) {
+                block-> code.RemoveAt(i);
+                block-> code.InsertAt(new Assign(dst, value.holder), i);
+                changed = true;
+            } else {
+                value.number = table-> NewNumber();
+                table-> Enter(key, value.number, dst-> GetSegment() == fpRelative ? dst : NULL);
+            }
+            table-> SetNumber(dst, value.number);
+        } else if (dynamic_cast<Assign*> (instr)) {
+            instr-> GetGen(&src);
+            table-> SetNumber(dst, table-> NumberOf(src));
+        } else {
+            bool clobbers = dynamic_cast<Store*> (instr) || dynamic_cast<LCall*> (instr) ||
+                            dynamic_cast<ACall*> (instr);
+            if (clobbers) table-> NewEpoch();
+            if (dst) table-> SetNumber(dst, table-> NewNumber());
+        }
+    }
+    for (int j = 0; j < block-> succs.NumElements(); j++) {
+        BasicBlock *succ = block-> succs.Nth(j);
+        if (succ-> preds.NumElements() == 1 && succ != block)
+            changed |= NumberBlock(succ, table);
+    }
+    table-> Restore(mark);
+    return changed;
+}
+
+/* Function: NumberValues
+ * ----------------------
+ * Starts a walk at the head of every extended basic block: each block
+ * with other than one predecessor. The rest are reached from their
+ * predecessor's walk.
+ */
+bool NumberValues(List<Instruction*> *tac)
+{
+    FlowGraph graph(tac, 0, tac-> NumElements() - 1);
+    ValueTable table;
+    bool changed = false;
+    for (int b = 0; b < graph.NumBlocks(); b++) {
+        BasicBlock *block = graph.Block(b);
+        if (block-> IsReachable() && block-> preds.NumElements() != 1)
+            changed |= NumberBlock(block, &table);
+    }
+    Relayout(&graph, tac);
+    return changed;
+}